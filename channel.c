@@ -12,6 +12,7 @@ shouldn't observably differ in any way other than execution duration.
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -57,6 +58,10 @@ static int msleep(long msec)
 
 pthread_mutex_t mutex;
 
+// Additional delay of sends through given descriptor (see channel_set_delay).
+static int *fd_delays = NULL;
+static int fd_delays_size = 0;
+
 static void delay(const char *delay_var, const size_t size)
 {
     ASSERT_ZERO(pthread_mutex_lock(&mutex));
@@ -90,11 +95,32 @@ void channels_init() {
 
 void channels_finalize() {
     ASSERT_ZERO(pthread_mutex_destroy(&mutex));
+    free(fd_delays);
+    fd_delays = NULL;
+    fd_delays_size = 0;
+}
+
+void channel_set_delay(int fd, int delay_ms)
+{
+    if (fd >= fd_delays_size)
+    {
+        int new_size = fd + 1;
+        int *new_delays = realloc(fd_delays, new_size * sizeof(int));
+        if (new_delays == NULL)
+            return;
+        for (int i = fd_delays_size; i < new_size; i++)
+            new_delays[i] = 0;
+        fd_delays = new_delays;
+        fd_delays_size = new_size;
+    }
+    fd_delays[fd] = delay_ms;
 }
 
 int chsend(int __fd, const void *__buf, size_t __n)
 {
     delay(WRITE_VAR, __n);
+    if (__fd < fd_delays_size && fd_delays[__fd] > 0)
+        msleep((__n + ATOMIC_BLOCK_SIZE - 1) / ATOMIC_BLOCK_SIZE * fd_delays[__fd]);
     return write(__fd, __buf, __n);
 }
 
@@ -104,3 +130,27 @@ int chrecv(int __fd, void *__buf, size_t __nbytes)
     delay(READ_VAR, __nbytes);
     return res;
 }
+
+static size_t iov_size(const struct iovec *__iov, int __iovcnt)
+{
+    size_t size = 0;
+    for (int i = 0; i < __iovcnt; i++)
+        size += __iov[i].iov_len;
+    return size;
+}
+
+int chsendv(int __fd, const struct iovec *__iov, int __iovcnt)
+{
+    size_t size = iov_size(__iov, __iovcnt);
+    delay(WRITE_VAR, size);
+    if (__fd < fd_delays_size && fd_delays[__fd] > 0)
+        msleep((size + ATOMIC_BLOCK_SIZE - 1) / ATOMIC_BLOCK_SIZE * fd_delays[__fd]);
+    return writev(__fd, __iov, __iovcnt);
+}
+
+int chrecvv(int __fd, const struct iovec *__iov, int __iovcnt)
+{
+    ssize_t res = readv(__fd, __iov, __iovcnt);
+    delay(READ_VAR, iov_size(__iov, __iovcnt));
+    return res;
+}
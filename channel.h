@@ -9,6 +9,7 @@ Overview rules to apply:
 #ifndef CHANNEL_H
 #define CHANNEL_H
 #include <stddef.h>
+#include <sys/uio.h>
 
 /*
 This is required to be called in MIMPI_Init.
@@ -25,6 +26,11 @@ Works similarly to `pipe`, but possibly takes more time to finish.
 */
 int channel(int pipefd[2]);
 /*
+Makes every send through `fd` take additionally `delay_ms` milliseconds
+per started 512 bytes, to simulate slower link (e.g. between hosts).
+*/
+void channel_set_delay(int fd, int delay_ms);
+/*
 Works similarly to `write`, but possibly takes more time to finish.
 */
 int chsend(int __fd, const void *__buf, size_t __n);
@@ -32,5 +38,13 @@ int chsend(int __fd, const void *__buf, size_t __n);
 Works similarly to `read`, but possibly takes more time to finish.
 */
 int chrecv(int __fd, void *__buf, size_t __nbytes);
+/*
+Works similarly to `writev`, but possibly takes more time to finish.
+*/
+int chsendv(int __fd, const struct iovec *__iov, int __iovcnt);
+/*
+Works similarly to `readv`, but possibly takes more time to finish.
+*/
+int chrecvv(int __fd, const struct iovec *__iov, int __iovcnt);
 
 #endif /* CHANNEL_H */
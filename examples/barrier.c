@@ -0,0 +1,68 @@
+/**
+ * Checks Barrier: many barriers in a row (so that shared state is reused
+ * many times), waiting for process that comes late in turn and
+ * MIMPI_ERROR_REMOTE_FINISHED once a process has finalized.
+ * Usage:
+ *     mimpirun n examples_build/barrier     (n >= 2)
+ * */
+#include "../mimpi.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ROUNDS 2000
+#define LATE_ROUNDS 4
+#define LATE_US 50000
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 2) {
+        printf("needs at least 2 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    for (int round = 0; round < ROUNDS; round++)
+        check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+
+    for (int round = 0; round < LATE_ROUNDS; round++) {
+        int late = round % size;
+        if (rank == late)
+            usleep(LATE_US);
+
+        double start = now();
+        check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+        if (rank != late)
+            check(now() - start > LATE_US * 0.9e-6, "Barrier did not wait for late process");
+    }
+
+    // Last process finalizes, others must notice it.
+    if (rank != size - 1)
+        check(MIMPI_Barrier() == MIMPI_ERROR_REMOTE_FINISHED, "Barrier did not notice finished process");
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+/**
+ * Checks communicators: splitting world into even and odd processes (in
+ * reversed order), collectives within halves, duplicate of world and
+ * messeges of one communicator not matching receives in another. Usage:
+ *     mimpirun n examples_build/communicators     (n >= 2)
+ * */
+#include "../mimpi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define ITERATIONS 20
+#define TAG 5
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 2) {
+        printf("needs at least 2 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    // Key -rank orders processes of half backwards.
+    MIMPI_Comm half;
+    check(MIMPI_Comm_split(MIMPI_COMM_WORLD, rank % 2, -rank, &half) == MIMPI_SUCCESS, "Comm_split failed");
+    int half_rank = MIMPI_Comm_rank(half);
+    int half_size = MIMPI_Comm_size(half);
+    check(half_size == (size + 1 - rank % 2) / 2, "wrong size of half");
+    check(half_rank == half_size - 1 - rank / 2, "wrong rank in half");
+
+    MIMPI_Comm without_first;
+    check(MIMPI_Comm_split(MIMPI_COMM_WORLD, rank == 0 ? MIMPI_UNDEFINED : 1, rank, &without_first) == MIMPI_SUCCESS,
+          "Comm_split with MIMPI_UNDEFINED failed");
+    check((rank == 0) == (without_first == MIMPI_COMM_NULL), "MIMPI_UNDEFINED color not respected");
+
+    MIMPI_Comm dup;
+    check(MIMPI_Comm_dup(MIMPI_COMM_WORLD, &dup) == MIMPI_SUCCESS, "Comm_dup failed");
+    check(MIMPI_Comm_rank(dup) == rank && MIMPI_Comm_size(dup) == size, "wrong rank or size in duplicate");
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        check(MIMPI_Barrier_comm(half) == MIMPI_SUCCESS, "Barrier in half failed");
+
+        for (int root = 0; root < half_size; root++) {
+            int value = half_rank == root ? 1000 + root + it : -1;
+            check(MIMPI_Bcast_comm(&value, sizeof(value), root, half) == MIMPI_SUCCESS, "Bcast in half failed");
+            check(value == 1000 + root + it, "wrong data after Bcast in half");
+
+            uint8_t own = (uint8_t)(rank + 1), sum = 0;
+            check(MIMPI_Reduce_comm(&own, &sum, 1, MIMPI_SUM, root, half) == MIMPI_SUCCESS, "Reduce in half failed");
+            if (half_rank == root) {
+                int expected = 0;
+                for (int i = rank % 2; i < size; i += 2)
+                    expected += i + 1;
+                check(sum == (uint8_t)expected, "wrong result of Reduce in half");
+            }
+        }
+    }
+
+    // Messege sent in duplicate first must not be taken by receive in world.
+    if (rank == 0) {
+        int in_dup = 1, in_world = 2;
+        check(MIMPI_Send_comm(&in_dup, sizeof(int), 1, TAG, dup) == MIMPI_SUCCESS, "Send in duplicate failed");
+        check(MIMPI_Send(&in_world, sizeof(int), 1, TAG) == MIMPI_SUCCESS, "Send in world failed");
+    } else if (rank == 1) {
+        int in_dup = 0, in_world = 0;
+        check(MIMPI_Recv(&in_world, sizeof(int), 0, TAG) == MIMPI_SUCCESS, "Recv in world failed");
+        check(MIMPI_Recv_comm(&in_dup, sizeof(int), 0, TAG, dup) == MIMPI_SUCCESS, "Recv in duplicate failed");
+        check(in_world == 2 && in_dup == 1, "messege matched receive of other communicator");
+    }
+
+    check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+
+    MIMPI_Comm_free(&half);
+    MIMPI_Comm_free(&without_first);
+    MIMPI_Comm_free(&dup);
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+/**
+ * Checks compression of messeges: sparse, repetitive and random data of
+ * many sizes goes around ring, both into receive posted earlier and as
+ * unexpected messege. Random data does not compress, so compression to
+ * that process is paused for a while. Usage:
+ *     mimpirun n examples_build/compression [threshold bytes]     (n >= 2)
+ * */
+#include "../mimpi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEFAULT_THRESHOLD "64"
+
+enum kind_t {
+    Sparse,
+    Repetitive,
+    Random,
+    Kinds,
+};
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static uint8_t element(enum kind_t kind, int i, int process) {
+    switch (kind) {
+    case Sparse:
+        return i % 97 == 0 ? (uint8_t)(i * 31 + process) : 0;
+    case Repetitive:
+        return (uint8_t)((i / 4) % 3 + process);
+    default:
+        return (uint8_t)(((uint32_t)i * 2654435761u + process * 40503u) >> 13);
+    }
+}
+
+static bool matches(uint8_t const *data, int count, enum kind_t kind, int process) {
+    bool same = true;
+    for (int i = 0; i < count; i++)
+        same &= data[i] == element(kind, i, process);
+    return same;
+}
+
+int main(int argc, char **argv) {
+    // Threshold is read in MIMPI_Init.
+    setenv("MIMPI_COMPRESS_THRESHOLD", argc > 1 ? argv[1] : DEFAULT_THRESHOLD, 1);
+
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 2) {
+        printf("needs at least 2 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    int next = (rank + 1) % size;
+    int previous = (rank + size - 1) % size;
+
+    for (int count = 1; count < 500000; count = count * 3 + 1) {
+        uint8_t *send_data = malloc(count);
+        uint8_t *recv_data = malloc(count);
+        if (send_data == NULL || recv_data == NULL)
+            return 1;
+
+        for (enum kind_t kind = 0; kind < Kinds; kind++) {
+            for (int i = 0; i < count; i++)
+                send_data[i] = element(kind, i, rank);
+
+            MIMPI_Request recv;
+            check(MIMPI_Recv_init(recv_data, count, previous, kind, MIMPI_COMM_WORLD, &recv) == MIMPI_SUCCESS,
+                  "Recv_init failed");
+            check(MIMPI_Start(recv) == MIMPI_SUCCESS, "Start of receive failed");
+            check(MIMPI_Send(send_data, count, next, kind) == MIMPI_SUCCESS, "Send failed");
+            check(MIMPI_Wait(recv) == MIMPI_SUCCESS, "Wait for receive failed");
+            MIMPI_Request_free(&recv);
+            check(matches(recv_data, count, kind, previous), "wrong data in receive posted earlier");
+
+            check(MIMPI_Send(send_data, count, next, Kinds + kind) == MIMPI_SUCCESS, "Send failed");
+            check(MIMPI_Recv(recv_data, count, previous, Kinds + kind) == MIMPI_SUCCESS, "Recv failed");
+            check(matches(recv_data, count, kind, previous), "wrong data of unexpected messege");
+        }
+
+        free(send_data);
+        free(recv_data);
+    }
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
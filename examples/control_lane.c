@@ -0,0 +1,87 @@
+/**
+ * Checks that control traffic does not wait behind bulk data: with big
+ * messeges in flight processes synchronize with Barrier, and deadlock of
+ * processes 0 and 1 is detected while big messege from 1 is still not
+ * received by 0. Usage:
+ *     mimpirun n examples_build/control_lane     (n >= 2)
+ * */
+#include "../mimpi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BIG_COUNT (48 << 20)
+#define ROUNDS 3
+#define BARRIERS 200
+#define BIG_TAG 5
+#define REPLY_TAG 6
+#define QUEUED_TAG 7
+#define NEVER_TAG 9
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(true);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 2) {
+        printf("needs at least 2 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    char *big = malloc(BIG_COUNT);
+    if (big == NULL)
+        return 1;
+    char reply = 0;
+
+    for (int round = 0; round < ROUNDS; round++) {
+        if (rank == 1) {
+            memset(big, round + 1, BIG_COUNT);
+            usleep(20000);
+            check(MIMPI_Send(big, BIG_COUNT, 0, BIG_TAG) == MIMPI_SUCCESS, "Send of big messege failed");
+            check(MIMPI_Recv(&reply, 1, 0, REPLY_TAG) == MIMPI_SUCCESS && reply == round, "wrong reply");
+        }
+        if (rank == 0) {
+            check(MIMPI_Recv(big, BIG_COUNT, 1, BIG_TAG) == MIMPI_SUCCESS, "Recv of big messege failed");
+            check(big[0] == round + 1 && big[BIG_COUNT - 1] == round + 1, "wrong data of big messege");
+            reply = round;
+            check(MIMPI_Send(&reply, 1, 1, REPLY_TAG) == MIMPI_SUCCESS, "Send of reply failed");
+        }
+        check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+    }
+
+    for (int i = 0; i < BARRIERS; i++)
+        check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+
+    // Big messege waits unreceived while deadlock is being detected.
+    if (rank == 1) {
+        memset(big, 'q', BIG_COUNT);
+        check(MIMPI_Send(big, BIG_COUNT, 0, QUEUED_TAG) == MIMPI_SUCCESS, "Send of queued messege failed");
+    }
+    if (rank < 2)
+        check(MIMPI_Recv(&reply, 1, 1 - rank, NEVER_TAG) == MIMPI_ERROR_DEADLOCK_DETECTED, "deadlock not detected");
+    if (rank == 0) {
+        memset(big, 0, BIG_COUNT);
+        check(MIMPI_Recv(big, BIG_COUNT, 1, QUEUED_TAG) == MIMPI_SUCCESS, "Recv of queued messege failed");
+        check(big[0] == 'q' && big[BIG_COUNT - 1] == 'q', "wrong data of queued messege");
+    }
+
+    free(big);
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/**
+ * Checks live counters read by mimpitop: every process maps counters of
+ * its mimpirun, sees what next process is blocked on, and checks that
+ * messeges and bytes sent around ring, as well as messeges that came
+ * before they were waited for, are counted. Usage:
+ *     mimpirun n examples_build/counters     (n >= 2)
+ * */
+#include "../mimpi.h"
+#include "../mimpi_common.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define MESSEGES 20
+#define BYTES 5000
+#define TAG 4
+#define UNEXPECTED_TAG 5
+#define WAKE_TAG 6
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+// Counters are named after pid of mimpirun, which started this process.
+static struct stats_t *map_stats() {
+    char stats_name[ENVVAR_LEN];
+    sprintf(stats_name, STATS_NAME, getppid());
+
+    int stats_fd = shm_open(stats_name, O_RDONLY, 0);
+    if (stats_fd == -1)
+        return NULL;
+
+    struct stats_t *stats = mmap(NULL, sizeof(struct stats_t), PROT_READ, MAP_SHARED, stats_fd, 0);
+    ASSERT_ZERO(stats == MAP_FAILED);
+    ASSERT_SYS_OK(close(stats_fd));
+    return stats;
+}
+
+static void send_around_ring(char *data, int next, int previous, int tag) {
+    for (int i = 0; i < MESSEGES; i++)
+        check(MIMPI_Send(data, BYTES, next, tag) == MIMPI_SUCCESS, "Send failed");
+    for (int i = 0; i < MESSEGES; i++)
+        check(MIMPI_Recv(data, BYTES, previous, tag) == MIMPI_SUCCESS, "Recv failed");
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 2) {
+        printf("needs at least 2 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    struct stats_t *stats = map_stats();
+    if (stats == NULL) {
+        printf("process %d: no counters of mimpirun\n", rank);
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    struct stats_rank_t *own = &stats->ranks[rank];
+    check(stats->size == size, "wrong size in counters");
+    check(atomic_load(&own->pid) == getpid(), "wrong pid in counters");
+
+    int next = (rank + 1) % size;
+    int previous = (rank + size - 1) % size;
+    char *data = calloc(BYTES, 1);
+    if (data == NULL)
+        return 1;
+
+    long long sent_messeges = atomic_load(&own->peers[next].sent_messeges);
+    long long sent_bytes = atomic_load(&own->peers[next].sent_bytes);
+    long long received_messeges = atomic_load(&own->peers[previous].received_messeges);
+    long long received_bytes = atomic_load(&own->peers[previous].received_bytes);
+
+    // Barriers go through shared memory, so they send no messeges to count.
+    // They keep parts apart, so that counters are taken before others send.
+    check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+    send_around_ring(data, next, previous, TAG);
+
+    check(atomic_load(&own->peers[next].sent_messeges) - sent_messeges == MESSEGES, "wrong count of sent messeges");
+    check(atomic_load(&own->peers[next].sent_bytes) - sent_bytes == MESSEGES * BYTES, "wrong count of sent bytes");
+    check(atomic_load(&own->peers[previous].received_messeges) - received_messeges == MESSEGES,
+          "wrong count of received messeges");
+    check(atomic_load(&own->peers[previous].received_bytes) - received_bytes == MESSEGES * BYTES,
+          "wrong count of received bytes");
+
+    // Messeges are waited for only once all of them came, so all are unexpected.
+    check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+    long long unexpected_cnt = atomic_load(&own->unexpected_cnt);
+    received_messeges = atomic_load(&own->peers[previous].received_messeges);
+    check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+    for (int i = 0; i < MESSEGES; i++)
+        check(MIMPI_Send(data, BYTES, next, UNEXPECTED_TAG) == MIMPI_SUCCESS, "Send failed");
+    while (atomic_load(&own->peers[previous].received_messeges) - received_messeges < MESSEGES)
+        usleep(1000);
+    check(atomic_load(&own->unexpected_cnt) - unexpected_cnt == MESSEGES, "wrong count of unexpected messeges");
+    for (int i = 0; i < MESSEGES; i++)
+        check(MIMPI_Recv(data, BYTES, previous, UNEXPECTED_TAG) == MIMPI_SUCCESS, "Recv failed");
+
+    // Process 0 wakes process 1 once counters show it waits for process 0.
+    if (rank == 0) {
+        struct stats_rank_t *waiting = &stats->ranks[1];
+        while (atomic_load(&waiting->call) != Stats_recv || atomic_load(&waiting->peer) != 0)
+            usleep(1000);
+        check(MIMPI_Send(data, 1, 1, WAKE_TAG) == MIMPI_SUCCESS, "Send failed");
+    }
+    if (rank == 1) {
+        long long blocked_ns = atomic_load(&own->blocked_ns);
+        check(MIMPI_Recv(data, 1, 0, WAKE_TAG) == MIMPI_SUCCESS, "Recv failed");
+        check(atomic_load(&own->call) == Stats_none, "process still shown as blocked");
+        check(atomic_load(&own->blocked_ns) > blocked_ns, "time of waiting not counted");
+    }
+
+    free(data);
+    ASSERT_SYS_OK(munmap(stats, sizeof(struct stats_t)));
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
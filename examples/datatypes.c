@@ -0,0 +1,151 @@
+/**
+ * Checks derived datatypes: columns of matrix (vector of struct type)
+ * passed around ring with MIMPI_Send_type and MIMPI_Recv_type, contiguous
+ * messege received into two columns and Bcast_type of indexed type that
+ * must leave gaps untouched. Usage:
+ *     mimpirun n examples_build/datatypes     (n >= 2)
+ * */
+#include "../mimpi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ROWS 700
+#define COLUMNS 900
+#define ROUNDS 4
+#define CONTIGUOUS_TAG 50
+#define UNTOUCHED 0xEE
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static int32_t element(int process, int i) {
+    return process * 1000000 + i;
+}
+
+// Sends in processes of even rank first, so that ring does not deadlock.
+static void send_recv_type(
+    void const *send_data,
+    void *recv_data,
+    MIMPI_Datatype type,
+    int next,
+    int previous,
+    int tag
+) {
+    if (rank % 2 == 0)
+        check(MIMPI_Send_type(send_data, 1, type, next, tag, MIMPI_COMM_WORLD) == MIMPI_SUCCESS, "Send_type failed");
+    check(MIMPI_Recv_type(recv_data, 1, type, previous, tag, MIMPI_COMM_WORLD) == MIMPI_SUCCESS, "Recv_type failed");
+    if (rank % 2 == 1)
+        check(MIMPI_Send_type(send_data, 1, type, next, tag, MIMPI_COMM_WORLD) == MIMPI_SUCCESS, "Send_type failed");
+}
+
+static void test_columns(int next, int previous) {
+    int32_t *matrix = malloc(sizeof(int32_t) * ROWS * COLUMNS);
+    if (matrix == NULL)
+        exit(1);
+    for (int i = 0; i < ROWS * COLUMNS; i++)
+        matrix[i] = element(rank, i);
+
+    int block_length = sizeof(int32_t), displacement = 0;
+    MIMPI_Datatype byte = MIMPI_BYTE, int32, column, two_columns;
+    check(MIMPI_Type_create_struct(1, &block_length, &displacement, &byte, &int32) == MIMPI_SUCCESS,
+          "Type_create_struct failed");
+    check(MIMPI_Type_vector(ROWS, 1, COLUMNS, int32, &column) == MIMPI_SUCCESS, "Type_vector failed");
+    check(MIMPI_Type_vector(ROWS, 2, COLUMNS, int32, &two_columns) == MIMPI_SUCCESS, "Type_vector failed");
+    check(MIMPI_Type_size(column) == sizeof(int32_t) * ROWS, "wrong size of column type");
+
+    // Column c is received in place of column c + 1.
+    for (int round = 0; round < ROUNDS; round++) {
+        int c = round * 7;
+        // Sometimes messege comes before receive is posted.
+        if (round % 2)
+            usleep(20000);
+        send_recv_type(matrix + c, matrix + c + 1, column, next, previous, round);
+
+        bool same = true;
+        for (int i = 0; i < ROWS; i++)
+            same &= matrix[i * COLUMNS + c + 1] == element(previous, i * COLUMNS + c);
+        check(same, "wrong column after Recv_type");
+        for (int i = 0; i < ROWS; i++)
+            matrix[i * COLUMNS + c + 1] = element(rank, i * COLUMNS + c + 1);
+    }
+
+    // Contiguous data is spread over two columns.
+    int32_t *contiguous = malloc(sizeof(int32_t) * 2 * ROWS);
+    if (contiguous == NULL)
+        exit(1);
+    for (int i = 0; i < 2 * ROWS; i++)
+        contiguous[i] = -i - rank;
+
+    if (rank % 2 == 0)
+        check(MIMPI_Send(contiguous, sizeof(int32_t) * 2 * ROWS, next, CONTIGUOUS_TAG) == MIMPI_SUCCESS, "Send failed");
+    check(MIMPI_Recv_type(matrix + 3, 1, two_columns, previous, CONTIGUOUS_TAG, MIMPI_COMM_WORLD) == MIMPI_SUCCESS,
+          "Recv_type failed");
+    if (rank % 2 == 1)
+        check(MIMPI_Send(contiguous, sizeof(int32_t) * 2 * ROWS, next, CONTIGUOUS_TAG) == MIMPI_SUCCESS, "Send failed");
+
+    bool same = true;
+    for (int i = 0; i < ROWS; i++)
+        same &= matrix[i * COLUMNS + 3] == -2 * i - previous && matrix[i * COLUMNS + 4] == -2 * i - 1 - previous;
+    check(same, "wrong columns after Recv_type of contiguous messege");
+
+    MIMPI_Type_free(&two_columns);
+    MIMPI_Type_free(&column);
+    MIMPI_Type_free(&int32);
+    free(contiguous);
+    free(matrix);
+}
+
+// Indexed type of extent 25 covering bytes 0, 10..12 and 20..24.
+static void test_indexed() {
+    int block_lengths[3] = {3, 1, 5}, displacements[3] = {10, 0, 20};
+    MIMPI_Datatype indexed;
+    check(MIMPI_Type_indexed(3, block_lengths, displacements, MIMPI_BYTE, &indexed) == MIMPI_SUCCESS,
+          "Type_indexed failed");
+
+    uint8_t data[50];
+    for (int i = 0; i < 50; i++)
+        data[i] = rank == 0 ? (uint8_t)(i + 1) : UNTOUCHED;
+    check(MIMPI_Bcast_type(data, 2, indexed, 0, MIMPI_COMM_WORLD) == MIMPI_SUCCESS, "Bcast_type failed");
+
+    bool same = true;
+    for (int i = 0; i < 50; i++) {
+        int in_element = i % 25;
+        bool covered = in_element == 0 || (in_element >= 10 && in_element < 13) || in_element >= 20;
+        same &= data[i] == (covered || rank == 0 ? (uint8_t)(i + 1) : UNTOUCHED);
+    }
+    check(same, "wrong data or gaps touched after Bcast_type");
+
+    MIMPI_Type_free(&indexed);
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 2) {
+        printf("needs at least 2 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    test_columns((rank + 1) % size, (rank + size - 1) % size);
+    test_indexed();
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
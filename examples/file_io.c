@@ -0,0 +1,148 @@
+/**
+ * Checks collective and independent file I/O: contiguous parts of small
+ * and big size written with MIMPI_File_write_at_all and read back by other
+ * process, reading past end of file, and interleaved records with holes
+ * between them, which must keep what was in file before. Usage:
+ *     mimpirun n examples_build/file_io [path]
+ * */
+#include "../mimpi.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADER 100
+#define RECORD 3
+#define RECORDS 400000
+#define HOLE 0xEE
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static uint8_t element(int process, size_t i, int round) {
+    return (uint8_t)(process * 13 + i * 7 + round);
+}
+
+// Every process writes its part, then reads part of next process.
+static void test_contiguous(char const *path, int size, size_t count, int round) {
+    uint8_t *data = malloc(count);
+    if (data == NULL)
+        exit(1);
+    for (size_t i = 0; i < count; i++)
+        data[i] = element(rank, i, round);
+
+    MIMPI_File file;
+    check(MIMPI_File_open(MIMPI_COMM_WORLD, path, O_CREAT | O_TRUNC | O_RDWR, &file) == MIMPI_SUCCESS,
+          "File_open failed");
+    check(MIMPI_File_write_at_all(file, HEADER + rank * count, data, count, MIMPI_BYTE) == MIMPI_SUCCESS,
+          "File_write_at_all failed");
+    check(MIMPI_File_close(&file) == MIMPI_SUCCESS && file == NULL, "File_close failed");
+
+    int next = (rank + 1) % size;
+    memset(data, 0, count);
+    check(MIMPI_File_open(MIMPI_COMM_WORLD, path, O_RDONLY, &file) == MIMPI_SUCCESS, "File_open failed");
+    check(MIMPI_File_read_at_all(file, HEADER + next * count, data, count, MIMPI_BYTE) == MIMPI_SUCCESS,
+          "File_read_at_all failed");
+
+    bool same = true;
+    for (size_t i = 0; i < count; i++)
+        same &= data[i] == element(next, i, round);
+    check(same, "wrong data read back");
+
+    uint8_t past_end[10];
+    memset(past_end, 1, sizeof(past_end));
+    check(MIMPI_File_read_at_all(file, HEADER + size * count + 5, past_end, sizeof(past_end), MIMPI_BYTE)
+          == MIMPI_SUCCESS, "File_read_at_all past end of file failed");
+    same = true;
+    for (size_t i = 0; i < sizeof(past_end); i++)
+        same &= past_end[i] == 0;
+    check(same, "bytes past end of file not read as zeros");
+
+    check(MIMPI_File_close(&file) == MIMPI_SUCCESS, "File_close failed");
+    free(data);
+}
+
+// Record k of process r is at k * (size * RECORD + 1) + r * RECORD, last
+// byte of every row is hole filled earlier by process 0.
+static void test_interleaved(char const *path, int size) {
+    int stride = size * RECORD + 1;
+    size_t total = (size_t)RECORDS * stride;
+    size_t count = (size_t)RECORDS * RECORD;
+
+    MIMPI_Datatype filetype;
+    check(MIMPI_Type_vector(RECORDS, RECORD, stride, MIMPI_BYTE, &filetype) == MIMPI_SUCCESS, "Type_vector failed");
+
+    uint8_t *data = malloc(count);
+    uint8_t *file_data = malloc(total);
+    if (data == NULL || file_data == NULL)
+        exit(1);
+    for (size_t i = 0; i < count; i++)
+        data[i] = element(rank, i % 200, 1);
+
+    MIMPI_File file;
+    check(MIMPI_File_open(MIMPI_COMM_WORLD, path, O_CREAT | O_TRUNC | O_RDWR, &file) == MIMPI_SUCCESS,
+          "File_open failed");
+    if (rank == 0) {
+        memset(file_data, HOLE, total);
+        check(MIMPI_File_write_at(file, 0, file_data, total, MIMPI_BYTE) == MIMPI_SUCCESS, "File_write_at failed");
+    }
+    check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+    check(MIMPI_File_write_at_all(file, rank * RECORD, data, 1, filetype) == MIMPI_SUCCESS,
+          "File_write_at_all of records failed");
+    check(MIMPI_File_close(&file) == MIMPI_SUCCESS, "File_close failed");
+
+    // Whole file is read by every process on its own.
+    check(MIMPI_File_open(MIMPI_COMM_WORLD, path, O_RDONLY, &file) == MIMPI_SUCCESS, "File_open failed");
+    check(MIMPI_File_read_at(file, 0, file_data, total, MIMPI_BYTE) == MIMPI_SUCCESS, "File_read_at failed");
+
+    bool same = true;
+    for (int k = 0; k < RECORDS; k++) {
+        uint8_t const *row = file_data + (size_t)k * stride;
+        for (int process = 0; process < size; process++)
+            for (int i = 0; i < RECORD; i++)
+                same &= row[process * RECORD + i] == element(process, ((size_t)k * RECORD + i) % 200, 1);
+        same &= row[size * RECORD] == HOLE;
+    }
+    check(same, "wrong records or holes in file");
+
+    memset(data, 0, count);
+    check(MIMPI_File_read_at_all(file, rank * RECORD, data, 1, filetype) == MIMPI_SUCCESS,
+          "File_read_at_all of records failed");
+    same = true;
+    for (size_t i = 0; i < count; i++)
+        same &= data[i] == element(rank, i % 200, 1);
+    check(same, "wrong records read back");
+
+    check(MIMPI_File_close(&file) == MIMPI_SUCCESS, "File_close failed");
+    MIMPI_Type_free(&filetype);
+    free(data);
+    free(file_data);
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    char const *path = argc > 1 ? argv[1] : "file_io.out";
+
+    size_t counts[3] = {1000, 3 << 20, 5 << 20};
+    for (int round = 0; round < 3; round++)
+        test_contiguous(path, size, counts[round], round);
+    test_interleaved(path, size);
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
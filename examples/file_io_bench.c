@@ -0,0 +1,93 @@
+/**
+ * Compares collective file writes (MIMPI_File_write_at_all) with every
+ * process writing its own records (MIMPI_File_write_at).
+ *
+ * Records of processes are interleaved in file: record k of process r is
+ * at position k * size + r. Usage:
+ *     mimpirun n examples_build/file_io_bench [path] [record_bytes] [records]
+ * */
+#include "../mimpi.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fill(uint8_t *data, int record_bytes, int records, int rank) {
+    for (int k = 0; k < records; k++)
+        for (int i = 0; i < record_bytes; i++)
+            data[(size_t)k * record_bytes + i] = (uint8_t)(rank * 31 + k * 7 + i);
+}
+
+// Writes all records once and returns time between barriers around it.
+static double timed_write(char const *path, uint8_t *data, int records, MIMPI_Datatype filetype, size_t offset, bool collective) {
+    MIMPI_File file;
+    if (MIMPI_File_open(MIMPI_COMM_WORLD, path, O_CREAT | O_TRUNC | O_RDWR, &file) != MIMPI_SUCCESS)
+        exit(1);
+
+    MIMPI_Barrier();
+    double start = now();
+
+    MIMPI_Retcode result = collective ? MIMPI_File_write_at_all(file, offset, data, records, filetype)
+                                      : MIMPI_File_write_at(file, offset, data, records, filetype);
+    if (result != MIMPI_SUCCESS)
+        exit(1);
+
+    MIMPI_File_close(&file);
+    return now() - start;
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    char const *path = argc > 1 ? argv[1] : "file_io_bench.out";
+    int record_bytes = argc > 2 ? atoi(argv[2]) : 4096;
+    int records = argc > 3 ? atoi(argv[3]) : 1024;
+
+    int rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    size_t bytes = (size_t)record_bytes * records;
+
+    uint8_t *data = malloc(bytes);
+    uint8_t *check = malloc(bytes);
+    if (data == NULL || check == NULL)
+        return 1;
+    fill(data, record_bytes, records, rank);
+
+    MIMPI_Datatype filetype;
+    MIMPI_Type_vector(records, record_bytes, record_bytes * size, MIMPI_BYTE, &filetype);
+    size_t offset = (size_t)rank * record_bytes;
+
+    double independent = timed_write(path, data, 1, filetype, offset, false);
+    double collective = timed_write(path, data, 1, filetype, offset, true);
+
+    // Checking what collective write left in file.
+    MIMPI_File file;
+    MIMPI_File_open(MIMPI_COMM_WORLD, path, O_RDONLY, &file);
+    MIMPI_File_read_at_all(file, offset, check, 1, filetype);
+    MIMPI_File_close(&file);
+    bool correct = memcmp(data, check, bytes) == 0;
+
+    if (rank == 0) {
+        double megabytes = (double)bytes * size / (1024 * 1024);
+        printf("%d processes, %d records of %d bytes each\n", size, records, record_bytes);
+        printf("independent: %8.3f s %10.1f MiB/s\n", independent, megabytes / independent);
+        printf("collective:  %8.3f s %10.1f MiB/s\n", collective, megabytes / collective);
+    }
+    if (!correct)
+        printf("process %d: wrong data read back\n", rank);
+
+    MIMPI_Type_free(&filetype);
+    free(data);
+    free(check);
+    MIMPI_Finalize();
+    return correct ? 0 : 1;
+}
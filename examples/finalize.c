@@ -0,0 +1,92 @@
+/**
+ * Checks how finished processes are noticed: every process other than 0
+ * sends some messeges (last one big) to process 0 and finalizes right away.
+ * Process 0 must still receive all of them in order and only then get
+ * MIMPI_ERROR_REMOTE_FINISHED from Recv, Send and Barrier. Usage:
+ *     mimpirun n examples_build/finalize     (n >= 2)
+ * */
+#include "../mimpi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MESSEGES 50
+#define BIG_COUNT 1000000
+#define TAG 3
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static void send_and_finish() {
+    char *big = malloc(BIG_COUNT);
+    if (big == NULL)
+        exit(1);
+    memset(big, rank, BIG_COUNT);
+
+    for (int i = 0; i < MESSEGES; i++) {
+        int value = rank * 1000 + i;
+        check(MIMPI_Send(&value, sizeof(int), 0, TAG) == MIMPI_SUCCESS, "Send failed");
+    }
+    check(MIMPI_Send(big, BIG_COUNT, 0, TAG) == MIMPI_SUCCESS, "Send of big messege failed");
+    free(big);
+}
+
+static void receive_from_finished(int size) {
+    char *big = malloc(BIG_COUNT);
+    if (big == NULL)
+        exit(1);
+
+    for (int source = 1; source < size; source++) {
+        bool in_order = true;
+        for (int i = 0; i < MESSEGES; i++) {
+            int value = -1;
+            check(MIMPI_Recv(&value, sizeof(int), source, TAG) == MIMPI_SUCCESS, "Recv failed");
+            in_order &= value == source * 1000 + i;
+        }
+        check(in_order, "messeges of finished process lost or out of order");
+
+        memset(big, 0, BIG_COUNT);
+        check(MIMPI_Recv(big, BIG_COUNT, source, TAG) == MIMPI_SUCCESS, "Recv of big messege failed");
+        check(big[0] == source && big[BIG_COUNT - 1] == source, "wrong data of big messege");
+
+        int value;
+        check(MIMPI_Recv(&value, sizeof(int), source, TAG) == MIMPI_ERROR_REMOTE_FINISHED,
+              "Recv from finished process did not fail");
+        check(MIMPI_Send(&value, sizeof(int), source, TAG) == MIMPI_ERROR_REMOTE_FINISHED,
+              "Send to finished process did not fail");
+    }
+
+    check(MIMPI_Barrier() == MIMPI_ERROR_REMOTE_FINISHED, "Barrier did not notice finished processes");
+    free(big);
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 2) {
+        printf("needs at least 2 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    if (rank == 0)
+        receive_from_finished(size);
+    else
+        send_and_finish();
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+/**
+ * Checks collectives of grouped processes: Barrier, Bcast from every root
+ * and Reduce with commutative built-in and not commutative user operation.
+ * Unless MIMPI_GROUPS is given, processes are split into groups by parity
+ * of rank, so that groups are not contiguous. Usage:
+ *     [MIMPI_GROUPS=0,0,1,1] mimpirun n examples_build/grouped_collectives
+ * */
+#include "../mimpi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COUNT 100003
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+// Groups are read in MIMPI_Init, before world size can be asked for.
+static void set_groups() {
+    if (getenv("MIMPI_GROUPS") != NULL || getenv("MIMPI_WORLD_SIZE") == NULL)
+        return;
+
+    int size = atoi(getenv("MIMPI_WORLD_SIZE"));
+    char groups[64] = "";
+    for (int i = 0; i < size; i++)
+        strcat(groups, i % 2 ? ",1" : ",0");
+    setenv("MIMPI_GROUPS", groups + 1, 1);
+}
+
+// Keeps first of two values, so result tells which process came first.
+// Nothing is done, as inout holds data of lower ranks.
+static void first(void *inout, void const *in, int count) {
+}
+
+static uint8_t element(int i, int process) {
+    return (uint8_t)(i * 5 + process);
+}
+
+int main(int argc, char **argv) {
+    set_groups();
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+
+    MIMPI_Op first_op;
+    check(MIMPI_Op_create(first, 1, false, &first_op) == MIMPI_SUCCESS, "Op_create failed");
+
+    uint8_t *data = malloc(COUNT);
+    uint8_t *result = malloc(COUNT);
+    if (data == NULL || result == NULL)
+        return 1;
+
+    for (int root = 0; root < size; root++) {
+        check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+
+        for (int i = 0; i < COUNT; i++)
+            data[i] = rank == root ? (uint8_t)(i + root) : 0;
+        check(MIMPI_Bcast(data, COUNT, root) == MIMPI_SUCCESS, "Bcast failed");
+
+        bool same = true;
+        for (int i = 0; i < COUNT; i++)
+            same &= data[i] == (uint8_t)(i + root);
+        check(same, "wrong data after Bcast");
+
+        for (int i = 0; i < COUNT; i++)
+            data[i] = element(i, rank);
+        check(MIMPI_Reduce(data, result, COUNT, MIMPI_SUM, root) == MIMPI_SUCCESS, "Reduce failed");
+
+        if (rank == root) {
+            same = true;
+            for (int i = 0; i < COUNT; i++) {
+                uint8_t expected = 0;
+                for (int k = 0; k < size; k++)
+                    expected += element(i, k);
+                same &= result[i] == expected;
+            }
+            check(same, "wrong result of Reduce");
+        }
+
+        // Not commutative operation must see data of process 0 first.
+        check(MIMPI_Reduce(data, result, COUNT, first_op, root) == MIMPI_SUCCESS, "Reduce with user operation failed");
+        if (rank == root) {
+            same = true;
+            for (int i = 0; i < COUNT; i++)
+                same &= result[i] == element(i, 0);
+            check(same, "not commutative operation applied out of rank order");
+        }
+    }
+
+    free(data);
+    free(result);
+    MIMPI_Op_free(&first_op);
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+/**
+ * Checks that small messege is not held up by long messege of other
+ * process: process 1 sends 256 MiB to process 0 and, while it is being
+ * received, process 2 sends small messege with time of sending. Process 0
+ * must get it at once. Usage:
+ *     mimpirun n examples_build/head_of_line     (n >= 3)
+ * */
+#include "../mimpi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BIG_COUNT (256 << 20)
+#define BIG_TAG 1
+#define SMALL_TAG 2
+#define SMALL_DELAY_US 50000
+#define LATENCY_LIMIT 0.03
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+// Monotonic clock is the same for all processes of machine.
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char element(int i) {
+    return (char)(i / 4096);
+}
+
+static void receive() {
+    char *big = malloc(BIG_COUNT);
+    if (big == NULL)
+        exit(1);
+
+    MIMPI_Request request;
+    check(MIMPI_Recv_init(big, BIG_COUNT, 1, BIG_TAG, MIMPI_COMM_WORLD, &request) == MIMPI_SUCCESS,
+          "Recv_init failed");
+    check(MIMPI_Start(request) == MIMPI_SUCCESS, "Start failed");
+    check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+
+    double sent_at = 0;
+    check(MIMPI_Recv(&sent_at, sizeof(double), 2, SMALL_TAG) == MIMPI_SUCCESS, "Recv of small messege failed");
+    double latency = now() - sent_at;
+
+    // Small messege had to wait only if long one was done by then anyway.
+    bool big_done;
+    check(MIMPI_Test(request, &big_done) == MIMPI_SUCCESS, "Test failed");
+    check(!big_done || latency < LATENCY_LIMIT, "small messege waited for long one");
+
+    check(MIMPI_Wait(request) == MIMPI_SUCCESS, "Wait failed");
+    MIMPI_Request_free(&request);
+
+    bool same = true;
+    for (int i = 0; i < BIG_COUNT; i += 4096)
+        same &= big[i] == element(i);
+    check(same, "wrong data of long messege");
+    free(big);
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 3) {
+        printf("needs at least 3 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    if (rank == 0) {
+        receive();
+    } else if (rank == 1) {
+        char *big = malloc(BIG_COUNT);
+        if (big == NULL)
+            return 1;
+        for (int i = 0; i < BIG_COUNT; i += 4096)
+            big[i] = element(i);
+
+        check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+        check(MIMPI_Send(big, BIG_COUNT, 0, BIG_TAG) == MIMPI_SUCCESS, "Send of long messege failed");
+        free(big);
+    } else {
+        check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+        if (rank == 2) {
+            usleep(SMALL_DELAY_US);
+            double sent_at = now();
+            check(MIMPI_Send(&sent_at, sizeof(double), 0, SMALL_TAG) == MIMPI_SUCCESS, "Send of small messege failed");
+        }
+    }
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+/**
+ * Checks Reduce with MIMPI_IN_PLACE: result replaces data of root (data of
+ * other processes may be used as scratch), and ordinary Reduce does not
+ * change data sent. Done both in world and in its duplicate (which goes
+ * through channels instead of shared memory). Usage:
+ *     mimpirun n examples_build/in_place
+ * */
+#include "../mimpi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static uint8_t element(int i, int process) {
+    return (uint8_t)(i * 13 + process);
+}
+
+static uint8_t expected_sum(int i, int size) {
+    uint8_t sum = 0;
+    for (int k = 0; k < size; k++)
+        sum += element(i, k);
+    return sum;
+}
+
+static void test(MIMPI_Comm comm, int size) {
+    for (int count = 1; count < 300000; count = count * 5 + 3) {
+        uint8_t *data = malloc(count);
+        uint8_t *result = malloc(count);
+        if (data == NULL || result == NULL)
+            exit(1);
+
+        for (int root = 0; root < size; root++) {
+            for (int i = 0; i < count; i++)
+                data[i] = element(i, rank);
+            check(MIMPI_Reduce_comm(MIMPI_IN_PLACE, data, count, MIMPI_SUM, root, comm) == MIMPI_SUCCESS,
+                  "Reduce in place failed");
+
+            if (rank == root) {
+                bool same = true;
+                for (int i = 0; i < count; i++)
+                    same &= data[i] == expected_sum(i, size);
+                check(same, "wrong result of Reduce in place");
+            }
+
+            for (int i = 0; i < count; i++)
+                data[i] = element(i, rank);
+            check(MIMPI_Reduce_comm(data, result, count, MIMPI_SUM, root, comm) == MIMPI_SUCCESS, "Reduce failed");
+
+            bool same = true;
+            for (int i = 0; i < count; i++) {
+                same &= data[i] == element(i, rank);
+                if (rank == root)
+                    same &= result[i] == expected_sum(i, size);
+            }
+            check(same, "wrong result of Reduce or data sent changed");
+        }
+
+        free(data);
+        free(result);
+    }
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+
+    MIMPI_Comm dup;
+    check(MIMPI_Comm_dup(MIMPI_COMM_WORLD, &dup) == MIMPI_SUCCESS, "Comm_dup failed");
+
+    test(MIMPI_COMM_WORLD, size);
+    test(dup, size);
+
+    MIMPI_Comm_free(&dup);
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
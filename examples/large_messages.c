@@ -0,0 +1,90 @@
+/**
+ * Checks MIMPI_Send_large and MIMPI_Recv_large: data of size that is not
+ * multiple of chunk is passed around ring, then empty messege is sent and
+ * Recv_large from finished process must fail. Size (in MiB) may be given,
+ * e.g. 2100 to check messege over 2 GiB. Usage:
+ *     mimpirun n examples_build/large_messages [MiB]     (n >= 2)
+ * */
+#include "../mimpi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEFAULT_MIB 40
+#define TAG 7
+#define EMPTY_TAG 3
+#define NEVER_TAG 9
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static uint8_t element(size_t i, int process) {
+    return (uint8_t)(i * 13 + (i >> 24) + process);
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 2) {
+        printf("needs at least 2 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    size_t count = (argc > 1 ? (size_t)atol(argv[1]) : DEFAULT_MIB) * 1024 * 1024 + 12345;
+    uint8_t *send_data = malloc(count);
+    uint8_t *recv_data = malloc(count);
+    if (send_data == NULL || recv_data == NULL)
+        return 1;
+
+    for (size_t i = 0; i < count; i++)
+        send_data[i] = element(i, rank);
+
+    // Send_large waits for matching receive, so odd processes receive first.
+    int next = (rank + 1) % size;
+    int previous = (rank + size - 1) % size;
+    if (rank % 2 == 0) {
+        check(MIMPI_Send_large(send_data, count, next, TAG, MIMPI_COMM_WORLD) == MIMPI_SUCCESS, "Send_large failed");
+        check(MIMPI_Recv_large(recv_data, count, previous, TAG, MIMPI_COMM_WORLD) == MIMPI_SUCCESS,
+              "Recv_large failed");
+    } else {
+        check(MIMPI_Recv_large(recv_data, count, previous, TAG, MIMPI_COMM_WORLD) == MIMPI_SUCCESS,
+              "Recv_large failed");
+        check(MIMPI_Send_large(send_data, count, next, TAG, MIMPI_COMM_WORLD) == MIMPI_SUCCESS, "Send_large failed");
+    }
+
+    bool same = true;
+    for (size_t i = 0; i < count; i++)
+        same &= recv_data[i] == element(i, previous);
+    check(same, "wrong data of Recv_large");
+
+    if (rank == 0)
+        check(MIMPI_Send_large(send_data, 0, 1, EMPTY_TAG, MIMPI_COMM_WORLD) == MIMPI_SUCCESS,
+              "Send_large of empty messege failed");
+    if (rank == 1)
+        check(MIMPI_Recv_large(recv_data, 0, 0, EMPTY_TAG, MIMPI_COMM_WORLD) == MIMPI_SUCCESS,
+              "Recv_large of empty messege failed");
+
+    // Process 1 finalizes, so process 0 must not wait for it.
+    if (rank == 0)
+        check(MIMPI_Recv_large(recv_data, count, 1, NEVER_TAG, MIMPI_COMM_WORLD) == MIMPI_ERROR_REMOTE_FINISHED,
+              "Recv_large from finished process did not fail");
+
+    free(send_data);
+    free(recv_data);
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+/**
+ * Checks neighbourhood collectives: 1-D grid with and without wrapping,
+ * 2-D grid {n, 1} wrapping in both dimensions (where every process is its
+ * own neighbour in the second one) and graph listing neighbours twice and
+ * the process itself. Usage:
+ *     mimpirun n examples_build/neighborhood
+ * */
+#include "../mimpi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BIG 200000
+#define ITERATIONS 3
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+// Block i of send data of process p is filled with p * 10 + i.
+static void fill_blocks(char *data, int blocks, int count) {
+    for (int i = 0; i < blocks; i++)
+        memset(data + i * count, rank * 10 + i, count);
+}
+
+// Whether block got from neighbour is what it sent in its block.
+static bool block_from(char const *data, int block, int count, int neighbor, int neighbor_block) {
+    char value = (char)(neighbor * 10 + neighbor_block);
+    return data[block * count] == value && data[(block + 1) * count - 1] == value;
+}
+
+static void test_line(int size) {
+    int lower = (rank + size - 1) % size;
+    int higher = (rank + 1) % size;
+
+    for (int periodic = 0; periodic < 2; periodic++) {
+        MIMPI_Comm line;
+        int dims[1] = {size};
+        bool periods[1] = {periodic};
+        check(MIMPI_Cart_create(MIMPI_COMM_WORLD, 1, dims, periods, &line) == MIMPI_SUCCESS, "Cart_create failed");
+        check(MIMPI_Neighbors_count(line) == 2, "wrong number of neighbours");
+
+        char *send_data = malloc(2 * BIG);
+        char *recv_data = malloc(2 * BIG);
+        if (send_data == NULL || recv_data == NULL)
+            exit(1);
+
+        fill_blocks(send_data, 2, BIG);
+        memset(recv_data, -1, 2 * BIG);
+        check(MIMPI_Neighbor_alltoall(send_data, BIG, recv_data, line) == MIMPI_SUCCESS, "Neighbor_alltoall failed");
+
+        // Lower neighbour sends towards higher coordinate in its block 1.
+        if (periodic || rank > 0)
+            check(block_from(recv_data, 0, BIG, lower, 1), "wrong data from lower neighbour");
+        else
+            check(recv_data[0] == -1, "data from not existing neighbour");
+        if (periodic || rank < size - 1)
+            check(block_from(recv_data, 1, BIG, higher, 0), "wrong data from higher neighbour");
+        else
+            check(recv_data[BIG] == -1, "data from not existing neighbour");
+
+        free(send_data);
+        free(recv_data);
+        MIMPI_Comm_free(&line);
+    }
+}
+
+static void test_self(int size) {
+    MIMPI_Comm grid;
+    int dims[2] = {size, 1};
+    bool periods[2] = {true, true};
+    check(MIMPI_Cart_create(MIMPI_COMM_WORLD, 2, dims, periods, &grid) == MIMPI_SUCCESS, "Cart_create failed");
+
+    char *send_data = malloc(4 * BIG);
+    char *recv_data = malloc(4 * BIG);
+    if (send_data == NULL || recv_data == NULL)
+        exit(1);
+
+    int lower = (rank + size - 1) % size;
+    int higher = (rank + 1) % size;
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        memset(send_data, rank, BIG);
+        check(MIMPI_Neighbor_allgather(send_data, BIG, recv_data, grid) == MIMPI_SUCCESS, "Neighbor_allgather failed");
+
+        bool same = true;
+        for (int i = 0; i < 4; i++) {
+            int from = i == 0 ? lower : i == 1 ? higher : rank;
+            same &= recv_data[i * BIG] == from && recv_data[(i + 1) * BIG - 1] == from;
+        }
+        check(same, "wrong data of Neighbor_allgather with itself as neighbour");
+
+        // In second dimension process sends to itself through both sides.
+        fill_blocks(send_data, 4, BIG);
+        check(MIMPI_Neighbor_alltoall(send_data, BIG, recv_data, grid) == MIMPI_SUCCESS, "Neighbor_alltoall failed");
+        check(block_from(recv_data, 0, BIG, lower, 1) && block_from(recv_data, 1, BIG, higher, 0) &&
+              block_from(recv_data, 2, BIG, rank, 3) && block_from(recv_data, 3, BIG, rank, 2),
+              "wrong data of Neighbor_alltoall with itself as neighbour");
+    }
+
+    free(send_data);
+    free(recv_data);
+    MIMPI_Comm_free(&grid);
+}
+
+// Every process lists itself, next, itself and previous one, so the
+// relation is symmetric. Repeated neighbours are matched in order.
+static void test_graph(int size) {
+    int next = (rank + 1) % size;
+    int previous = (rank + size - 1) % size;
+    int neighbors[4] = {rank, next, rank, previous};
+
+    MIMPI_Comm graph;
+    check(MIMPI_Graph_create(MIMPI_COMM_WORLD, 4, neighbors, &graph) == MIMPI_SUCCESS, "Graph_create failed");
+
+    char send_data[4], recv_data[4];
+    fill_blocks(send_data, 4, 1);
+    check(MIMPI_Neighbor_alltoall(send_data, 1, recv_data, graph) == MIMPI_SUCCESS, "Neighbor_alltoall failed");
+
+    check(block_from(recv_data, 0, 1, rank, 0) && block_from(recv_data, 2, 1, rank, 2), "wrong data from itself");
+    if (size > 2) {
+        check(block_from(recv_data, 1, 1, next, 3), "wrong data from next process");
+        check(block_from(recv_data, 3, 1, previous, 1), "wrong data from previous process");
+    }
+
+    MIMPI_Comm_free(&graph);
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+
+    test_line(size);
+    test_self(size);
+    test_graph(size);
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+/**
+ * Checks nonblocking collectives: Ibarrier, Ibcast and Ireduce started at
+ * once, overlapped with computation and then finished either by waiting
+ * in reversed order or by testing until all are done. Usage:
+ *     mimpirun n examples_build/nonblocking_collectives
+ * */
+#include "../mimpi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ITERATIONS 30
+#define REQUESTS 3
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static uint8_t element(int i, int process) {
+    return (uint8_t)(i * 3 + process);
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+
+    for (int it = 0; it < ITERATIONS; it++) {
+        int count = (it * 3779) % 200000 + 1;
+        int bcast_root = it % size;
+        int reduce_root = (it + 1) % size;
+
+        uint8_t *bcast_data = malloc(count);
+        uint8_t *reduce_data = malloc(count);
+        uint8_t *result = malloc(count);
+        if (bcast_data == NULL || reduce_data == NULL || result == NULL)
+            return 1;
+
+        for (int i = 0; i < count; i++) {
+            bcast_data[i] = rank == bcast_root ? (uint8_t)(i + it) : 0;
+            reduce_data[i] = element(i, rank);
+        }
+
+        MIMPI_Request requests[REQUESTS];
+        check(MIMPI_Ibarrier(MIMPI_COMM_WORLD, &requests[0]) == MIMPI_SUCCESS, "Ibarrier failed");
+        check(MIMPI_Ibcast(bcast_data, count, bcast_root, MIMPI_COMM_WORLD, &requests[1]) == MIMPI_SUCCESS,
+              "Ibcast failed");
+        check(MIMPI_Ireduce(reduce_data, result, count, MIMPI_SUM, reduce_root, MIMPI_COMM_WORLD, &requests[2])
+              == MIMPI_SUCCESS, "Ireduce failed");
+
+        // Data sent is copied at start, so it can be changed right away.
+        for (int i = 0; i < count; i++)
+            reduce_data[i] = 0;
+
+        volatile long sum = 0;
+        for (int i = 0; i < 100000; i++)
+            sum += i;
+
+        if (it % 2) {
+            for (int j = REQUESTS - 1; j >= 0; j--)
+                check(MIMPI_Wait(requests[j]) == MIMPI_SUCCESS, "Wait failed");
+        } else {
+            int done = 0;
+            while (done < REQUESTS) {
+                done = 0;
+                for (int j = 0; j < REQUESTS; j++) {
+                    bool flag;
+                    check(MIMPI_Test(requests[j], &flag) == MIMPI_SUCCESS, "Test failed");
+                    done += flag;
+                }
+            }
+        }
+
+        for (int j = 0; j < REQUESTS; j++)
+            MIMPI_Request_free(&requests[j]);
+
+        bool same = true;
+        for (int i = 0; i < count; i++)
+            same &= bcast_data[i] == (uint8_t)(i + it);
+        check(same, "wrong data after Ibcast");
+
+        if (rank == reduce_root) {
+            same = true;
+            for (int i = 0; i < count; i++) {
+                uint8_t expected = 0;
+                for (int k = 0; k < size; k++)
+                    expected += element(i, k);
+                same &= result[i] == expected;
+            }
+            check(same, "wrong result of Ireduce");
+        }
+
+        free(bcast_data);
+        free(reduce_data);
+        free(result);
+    }
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+/**
+ * Checks persistent requests: every process passes data to the next one in
+ * ring many times, starting the same pair of requests again and again.
+ * Usage:
+ *     mimpirun n examples_build/persistent_ring
+ * */
+#include "../mimpi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ITERATIONS 100
+#define TAG 3
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 2) {
+        printf("needs at least 2 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    int next = (rank + 1) % size;
+    int previous = (rank + size - 1) % size;
+
+    // Small messeges fit into header, big ones do not.
+    for (int bytes = 4; bytes <= 200000; bytes *= 50) {
+        int elements = bytes / sizeof(int);
+        int *send_data = malloc(bytes);
+        int *recv_data = malloc(bytes);
+        if (send_data == NULL || recv_data == NULL)
+            return 1;
+
+        MIMPI_Request send, recv;
+        check(MIMPI_Send_init(send_data, bytes, next, TAG, MIMPI_COMM_WORLD, &send) == MIMPI_SUCCESS, "Send_init failed");
+        check(MIMPI_Recv_init(recv_data, bytes, previous, TAG, MIMPI_COMM_WORLD, &recv) == MIMPI_SUCCESS, "Recv_init failed");
+
+        for (int it = 0; it < ITERATIONS; it++) {
+            // Data is taken at start, so it can change between iterations.
+            for (int i = 0; i < elements; i++)
+                send_data[i] = it * 1000 + rank + i;
+
+            check(MIMPI_Start(recv) == MIMPI_SUCCESS, "Start of receive failed");
+            check(MIMPI_Start(send) == MIMPI_SUCCESS, "Start of send failed");
+            check(MIMPI_Wait(send) == MIMPI_SUCCESS, "Wait for send failed");
+            check(MIMPI_Wait(recv) == MIMPI_SUCCESS, "Wait for receive failed");
+
+            bool same = true;
+            for (int i = 0; i < elements; i++)
+                same &= recv_data[i] == it * 1000 + previous + i;
+            check(same, "wrong data received");
+        }
+
+        MIMPI_Request_free(&send);
+        MIMPI_Request_free(&recv);
+        check(send == NULL && recv == NULL, "Request_free did not clear handles");
+
+        MIMPI_Barrier();
+        free(send_data);
+        free(recv_data);
+    }
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+/**
+ * Checks polling progress modes: without handler thread, pairs of
+ * processes send each other messeges larger than channel at the same time
+ * (so sends have to read incoming data meanwhile), then ring of small
+ * messeges and collectives. Usage:
+ *     mimpirun n examples_build/polling_progress [poll|busy]
+ * */
+#include "../mimpi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BIG (4 << 20)
+#define RING_ROUNDS 200
+#define TAG 7
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+// Both processes of pair send before they receive.
+static void exchange_big(int size) {
+    int peer = rank ^ 1;
+    if (peer >= size)
+        return;
+
+    char *send_data = malloc(BIG);
+    char *recv_data = malloc(BIG);
+    if (send_data == NULL || recv_data == NULL)
+        exit(1);
+    memset(send_data, rank + 1, BIG);
+
+    check(MIMPI_Send(send_data, BIG, peer, TAG) == MIMPI_SUCCESS, "Send of big messege failed");
+    check(MIMPI_Recv(recv_data, BIG, peer, TAG) == MIMPI_SUCCESS, "Recv of big messege failed");
+
+    bool same = true;
+    for (int i = 0; i < BIG; i++)
+        same &= recv_data[i] == peer + 1;
+    check(same, "wrong data of big messege");
+
+    free(send_data);
+    free(recv_data);
+}
+
+static void ring(int size) {
+    if (size < 2)
+        return;
+
+    int next = (rank + 1) % size;
+    int previous = (rank + size - 1) % size;
+
+    for (int round = 0; round < RING_ROUNDS; round++) {
+        int value = round * size + rank, got = -1;
+        if (rank == 0) {
+            check(MIMPI_Send(&value, sizeof(int), next, TAG) == MIMPI_SUCCESS, "Send in ring failed");
+            check(MIMPI_Recv(&got, sizeof(int), previous, TAG) == MIMPI_SUCCESS, "Recv in ring failed");
+        } else {
+            check(MIMPI_Recv(&got, sizeof(int), previous, TAG) == MIMPI_SUCCESS, "Recv in ring failed");
+            check(MIMPI_Send(&value, sizeof(int), next, TAG) == MIMPI_SUCCESS, "Send in ring failed");
+        }
+        check(got == round * size + previous, "wrong data in ring");
+    }
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Progress progress = MIMPI_PROGRESS_POLL;
+    if (argc > 1 && strcmp(argv[1], "busy") == 0)
+        progress = MIMPI_PROGRESS_BUSY_POLL;
+
+    MIMPI_Init_progress(false, progress);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+
+    exchange_big(size);
+    ring(size);
+
+    for (int root = 0; root < size; root++) {
+        int value = rank == root ? 100 + root : -1;
+        check(MIMPI_Bcast(&value, sizeof(int), root) == MIMPI_SUCCESS, "Bcast failed");
+        check(value == 100 + root, "wrong data after Bcast");
+    }
+    check(MIMPI_Barrier() == MIMPI_SUCCESS, "Barrier failed");
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
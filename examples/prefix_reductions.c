@@ -0,0 +1,112 @@
+/**
+ * Checks MIMPI_Scan and MIMPI_Exscan: prefix sums, composition of affine
+ * maps (not commutative, so order matters), Scan in place and Exscan in
+ * communicator with reversed order of processes. Usage:
+ *     mimpirun n examples_build/prefix_reductions
+ * */
+#include "../mimpi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAPS 2500
+#define UNTOUCHED 777
+
+// Map x -> x * mul + add.
+struct affine_t {
+    uint32_t mul;
+    uint32_t add;
+};
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+// First applies map of inout, then map of in.
+static void compose(void *inout, void const *in, int count) {
+    struct affine_t *first = inout;
+    struct affine_t const *second = in;
+    for (int i = 0; i < count; i++) {
+        first[i].add = first[i].add * second[i].mul + second[i].add;
+        first[i].mul *= second[i].mul;
+    }
+}
+
+static struct affine_t affine(int process, int i) {
+    return (struct affine_t){.mul = i + process * 100, .add = i + 1 + process * 100};
+}
+
+// Composition of maps of processes from 0 to last.
+static struct affine_t prefix(int last, int i) {
+    struct affine_t map = affine(0, i);
+    for (int k = 1; k <= last; k++) {
+        struct affine_t next = affine(k, i);
+        compose(&map, &next, 1);
+    }
+    return map;
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+
+    MIMPI_Op compose_op;
+    check(MIMPI_Op_create(compose, sizeof(struct affine_t), false, &compose_op) == MIMPI_SUCCESS, "Op_create failed");
+
+    struct affine_t *maps = malloc(MAPS * sizeof(struct affine_t));
+    struct affine_t *result = malloc(MAPS * sizeof(struct affine_t));
+    if (maps == NULL || result == NULL)
+        return 1;
+
+    for (int i = 0; i < MAPS; i++)
+        maps[i] = affine(rank, i);
+
+    check(MIMPI_Scan(maps, result, MAPS * sizeof(struct affine_t), compose_op) == MIMPI_SUCCESS, "Scan failed");
+    bool same = true;
+    for (int i = 0; i < MAPS; i++) {
+        struct affine_t expected = prefix(rank, i);
+        same &= result[i].mul == expected.mul && result[i].add == expected.add;
+    }
+    check(same, "wrong result of Scan");
+
+    // Result of Exscan in process 0 is not defined, so it is not touched.
+    for (int i = 0; i < MAPS; i++)
+        result[i] = (struct affine_t){UNTOUCHED, UNTOUCHED};
+    check(MIMPI_Exscan(maps, result, MAPS * sizeof(struct affine_t), compose_op) == MIMPI_SUCCESS, "Exscan failed");
+    same = true;
+    for (int i = 0; i < MAPS; i++) {
+        struct affine_t expected = rank == 0 ? (struct affine_t){UNTOUCHED, UNTOUCHED} : prefix(rank - 1, i);
+        same &= result[i].mul == expected.mul && result[i].add == expected.add;
+    }
+    check(same, "wrong result of Exscan");
+
+    uint8_t values[3] = {1, (uint8_t)rank, 2};
+    check(MIMPI_Scan(MIMPI_IN_PLACE, values, sizeof(values), MIMPI_SUM) == MIMPI_SUCCESS, "Scan in place failed");
+    check(values[0] == rank + 1 && values[1] == rank * (rank + 1) / 2 && values[2] == 2 * (rank + 1),
+          "wrong result of Scan in place");
+
+    MIMPI_Comm reversed;
+    check(MIMPI_Comm_split(MIMPI_COMM_WORLD, 0, -rank, &reversed) == MIMPI_SUCCESS, "Comm_split failed");
+    int one = 1, before = -1;
+    check(MIMPI_Exscan_comm(&one, &before, sizeof(int), MIMPI_SUM, reversed) == MIMPI_SUCCESS, "Exscan_comm failed");
+    if (MIMPI_Comm_rank(reversed) > 0)
+        check(before == MIMPI_Comm_rank(reversed), "wrong result of Exscan in communicator");
+
+    MIMPI_Comm_free(&reversed);
+    MIMPI_Op_free(&compose_op);
+    free(maps);
+    free(result);
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
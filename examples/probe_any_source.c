@@ -0,0 +1,125 @@
+/**
+ * Checks probing and receives from any process: process 0 takes messeges of
+ * sizes unknown in advance in order they come, learning size and sender by
+ * MIMPI_Probe, then drains the rest with MIMPI_Iprobe and receives from
+ * MIMPI_ANY_SOURCE until all others have finished. Usage:
+ *     mimpirun n examples_build/probe_any_source     (n >= 2)
+ * */
+#include "../mimpi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MESSEGES 3
+#define NOTE_TAG 77
+#define NOTES 2
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static int messege_size(int sender, int tag) {
+    return sender * 100 + tag;
+}
+
+static void collect(int size) {
+    int data_left = (size - 1) * MESSEGES;
+    int notes = 0;
+
+    while (data_left > 0) {
+        MIMPI_Status status;
+        check(MIMPI_Probe(MIMPI_ANY_SOURCE, MIMPI_ANY_TAG, MIMPI_COMM_WORLD, &status) == MIMPI_SUCCESS, "Probe failed");
+
+        if (status.tag == NOTE_TAG) {
+            int note;
+            check(status.count == sizeof(int), "wrong size of note");
+            check(MIMPI_Recv(&note, sizeof(int), status.source, NOTE_TAG) == MIMPI_SUCCESS, "Recv of note failed");
+            check(note == status.source, "wrong note");
+            notes++;
+            continue;
+        }
+
+        check(0 < status.source && status.source < size, "wrong source in status");
+        check(status.count == messege_size(status.source, status.tag), "wrong size in status");
+
+        char *data = malloc(status.count);
+        if (data == NULL)
+            exit(1);
+        check(MIMPI_Recv(data, status.count, status.source, status.tag) == MIMPI_SUCCESS, "Recv failed");
+
+        bool same = true;
+        for (int i = 0; i < status.count; i++)
+            same &= data[i] == (char)status.source;
+        check(same, "wrong data received");
+
+        free(data);
+        data_left--;
+    }
+
+    for (;;) {
+        bool flag;
+        MIMPI_Status status;
+        check(MIMPI_Iprobe(MIMPI_ANY_SOURCE, NOTE_TAG, MIMPI_COMM_WORLD, &flag, &status) == MIMPI_SUCCESS, "Iprobe failed");
+        if (!flag)
+            break;
+
+        int note;
+        check(MIMPI_Recv(&note, sizeof(int), status.source, NOTE_TAG) == MIMPI_SUCCESS, "Recv of note failed");
+        notes++;
+    }
+
+    // Notes that did not come yet are taken from anyone, until everybody ended.
+    for (;;) {
+        int note;
+        MIMPI_Retcode result = MIMPI_Recv(&note, sizeof(int), MIMPI_ANY_SOURCE, NOTE_TAG);
+        if (result != MIMPI_SUCCESS) {
+            check(result == MIMPI_ERROR_REMOTE_FINISHED, "Recv from any process failed with wrong code");
+            break;
+        }
+        notes++;
+    }
+
+    check(notes == (size - 1) * NOTES, "wrong number of notes");
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 2) {
+        printf("needs at least 2 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    if (rank == 0) {
+        collect(size);
+    } else {
+        for (int tag = 1; tag <= MESSEGES; tag++) {
+            int count = messege_size(rank, tag);
+            char *data = malloc(count);
+            if (data == NULL)
+                return 1;
+            memset(data, rank, count);
+            check(MIMPI_Send(data, count, 0, tag) == MIMPI_SUCCESS, "Send failed");
+            free(data);
+        }
+
+        for (int i = 0; i < NOTES; i++)
+            check(MIMPI_Send(&rank, sizeof(int), 0, NOTE_TAG) == MIMPI_SUCCESS, "Send of note failed");
+    }
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
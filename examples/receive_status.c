@@ -0,0 +1,93 @@
+/**
+ * Checks receives of messeges of size unknown in advance: every process
+ * sends data of varying length and tag to the next one, which receives it
+ * into big enough bufor and learns size, source and tag from status.
+ * Messege larger than capacity does not match and waits for next receive.
+ * Usage:
+ *     mimpirun n examples_build/receive_status     (n >= 2)
+ * */
+#include "../mimpi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CAPACITY 100000
+#define ROUNDS 40
+#define BIG_TAG 3
+#define BIG 50
+#define SMALL 10
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static int length(int round, int process) {
+    return (round * 7919 + process * 13) % (CAPACITY - 1000) + 1;
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 2) {
+        printf("needs at least 2 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    int next = (rank + 1) % size;
+    int previous = (rank + size - 1) % size;
+    char *send_data = malloc(CAPACITY);
+    char *recv_data = malloc(CAPACITY);
+    if (send_data == NULL || recv_data == NULL)
+        return 1;
+
+    for (int round = 0; round < ROUNDS; round++) {
+        int count = length(round, rank);
+        for (int i = 0; i < count; i++)
+            send_data[i] = (char)(i + round + rank);
+        check(MIMPI_Send(send_data, count, next, 5 + round % 3) == MIMPI_SUCCESS, "Send failed");
+
+        // Messege is sometimes already there and sometimes not yet.
+        if (round % 2)
+            MIMPI_Barrier();
+
+        MIMPI_Status status;
+        check(MIMPI_Recv_status(recv_data, CAPACITY, previous, MIMPI_ANY_TAG, MIMPI_COMM_WORLD, &status) == MIMPI_SUCCESS,
+              "Recv_status failed");
+
+        int expected = length(round, previous);
+        check(status.source == previous && status.tag == 5 + round % 3 && status.count == expected, "wrong status");
+
+        bool same = true;
+        for (int i = 0; i < expected; i++)
+            same &= recv_data[i] == (char)(i + round + previous);
+        check(same, "wrong data received");
+    }
+
+    if (rank == 0) {
+        check(MIMPI_Send(send_data, BIG, 1, BIG_TAG) == MIMPI_SUCCESS, "Send failed");
+        check(MIMPI_Send(send_data, SMALL, 1, BIG_TAG) == MIMPI_SUCCESS, "Send failed");
+    } else if (rank == 1) {
+        MIMPI_Status status;
+        check(MIMPI_Recv_status(recv_data, (BIG + SMALL) / 2, 0, BIG_TAG, MIMPI_COMM_WORLD, &status) == MIMPI_SUCCESS,
+              "Recv_status failed");
+        check(status.count == SMALL, "messege larger than capacity matched");
+        check(MIMPI_Recv(recv_data, BIG, 0, BIG_TAG) == MIMPI_SUCCESS, "Recv of larger messege failed");
+    }
+
+    free(send_data);
+    free(recv_data);
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
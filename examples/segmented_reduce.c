@@ -0,0 +1,94 @@
+/**
+ * Checks Reduce sent through channels in segments: sizes below, at and
+ * across many segments, every operation and every root. Reduce goes
+ * through duplicate of world, as Reduce over MIMPI_COMM_WORLD may use
+ * shared memory instead. Usage:
+ *     mimpirun n examples_build/segmented_reduce [segment bytes]
+ * */
+#include "../mimpi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static uint8_t element(int i, int process) {
+    return (uint8_t)(i * 7 + process * 3);
+}
+
+static uint8_t expected(MIMPI_Op op, int i, int size) {
+    uint8_t result = element(i, 0);
+    for (int k = 1; k < size; k++) {
+        uint8_t value = element(i, k);
+        switch (op) {
+        case MIMPI_MAX:  result = value > result ? value : result; break;
+        case MIMPI_MIN:  result = value < result ? value : result; break;
+        case MIMPI_SUM:  result += value; break;
+        case MIMPI_PROD: result *= value; break;
+        }
+    }
+    return result;
+}
+
+int main(int argc, char **argv) {
+    // Segment size is read in MIMPI_Init.
+    if (argc > 1)
+        setenv("MIMPI_REDUCE_SEGMENT", argv[1], 1);
+
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+
+    MIMPI_Comm comm;
+    check(MIMPI_Comm_dup(MIMPI_COMM_WORLD, &comm) == MIMPI_SUCCESS, "Comm_dup failed");
+
+    int counts[] = {0, 1, 100, 64 * 1024, 64 * 1024 + 1, 300001};
+    MIMPI_Op ops[] = {MIMPI_MAX, MIMPI_MIN, MIMPI_SUM, MIMPI_PROD};
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        int count = counts[c];
+        uint8_t *data = malloc(count + 1);
+        uint8_t *result = malloc(count + 1);
+        if (data == NULL || result == NULL)
+            return 1;
+
+        for (int i = 0; i < count; i++)
+            data[i] = element(i, rank);
+
+        for (int root = 0; root < size; root++) {
+            for (size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); o++) {
+                memset(result, 0, count + 1);
+                check(MIMPI_Reduce_comm(data, result, count, ops[o], root, comm) == MIMPI_SUCCESS, "Reduce failed");
+
+                if (rank == root) {
+                    bool same = true;
+                    for (int i = 0; i < count; i++)
+                        same &= result[i] == expected(ops[o], i, size);
+                    check(same, "wrong result of Reduce");
+                    check(result[count] == 0, "Reduce wrote past end of result");
+                }
+            }
+        }
+
+        free(data);
+        free(result);
+    }
+
+    MIMPI_Comm_free(&comm);
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+/**
+ * Checks MIMPI_Sendrecv and MIMPI_Sendrecv_replace: every process shifts
+ * data of growing size around ring at once, which would deadlock with
+ * blocking send followed by receive. Sendrecv with wrong destination or
+ * to finished process must fail at once instead of waiting for messege
+ * that never comes. Usage:
+ *     mimpirun n examples_build/sendrecv     (n >= 3)
+ * */
+#include "../mimpi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_COUNT 600000
+#define TAG 4
+#define REPLACE_TAG 6
+#define NEVER_TAG 8
+#define ENDING_RANK 2
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static void test_ring(int size) {
+    int next = (rank + 1) % size;
+    int previous = (rank + size - 1) % size;
+
+    for (int count = 1; count < MAX_COUNT; count = count * 4 + 5) {
+        char *send_data = malloc(count);
+        char *recv_data = malloc(count + 10);
+        if (send_data == NULL || recv_data == NULL)
+            exit(1);
+        memset(send_data, rank + 1, count);
+
+        MIMPI_Status status;
+        check(MIMPI_Sendrecv(send_data, count, next, TAG, recv_data, count + 10, previous, MIMPI_ANY_TAG,
+                             MIMPI_COMM_WORLD, &status) == MIMPI_SUCCESS, "Sendrecv failed");
+        check(status.count == count && status.source == previous && status.tag == TAG, "wrong status of Sendrecv");
+        check(recv_data[0] == previous + 1 && recv_data[count - 1] == previous + 1, "wrong data of Sendrecv");
+
+        check(MIMPI_Sendrecv_replace(send_data, count, next, REPLACE_TAG, previous, REPLACE_TAG,
+                                     MIMPI_COMM_WORLD, &status) == MIMPI_SUCCESS, "Sendrecv_replace failed");
+        check(send_data[0] == previous + 1 && send_data[count - 1] == previous + 1 && status.count == count,
+              "wrong data of Sendrecv_replace");
+
+        free(send_data);
+        free(recv_data);
+    }
+}
+
+// Nobody sends with NEVER_TAG, so these calls return only if they fail early.
+static void test_failing(int size) {
+    char data = 0, got;
+    int other = (rank + 1) % size;
+
+    check(MIMPI_Sendrecv(&data, 1, rank, TAG, &got, 1, other, NEVER_TAG, MIMPI_COMM_WORLD, NULL)
+          == MIMPI_ERROR_ATTEMPTED_SELF_OP, "Sendrecv to itself did not fail");
+    check(MIMPI_Sendrecv(&data, 1, size, TAG, &got, 1, other, NEVER_TAG, MIMPI_COMM_WORLD, NULL)
+          == MIMPI_ERROR_NO_SUCH_RANK, "Sendrecv to process out of world did not fail");
+    check(MIMPI_Sendrecv(&data, 1, -1, TAG, &got, 1, other, NEVER_TAG, MIMPI_COMM_WORLD, NULL)
+          == MIMPI_ERROR_NO_SUCH_RANK, "Sendrecv to negative rank did not fail");
+
+    MIMPI_Barrier();
+    if (rank == ENDING_RANK)
+        return;
+
+    // Receive from ending process returns once it has ended.
+    check(MIMPI_Recv(&got, 1, ENDING_RANK, NEVER_TAG) == MIMPI_ERROR_REMOTE_FINISHED,
+          "Recv from finished process did not fail");
+
+    int waiting = rank == 0 ? 1 : 0;
+    check(MIMPI_Sendrecv(&data, 1, ENDING_RANK, TAG, &got, 1, waiting, NEVER_TAG, MIMPI_COMM_WORLD, NULL)
+          == MIMPI_ERROR_REMOTE_FINISHED, "Sendrecv to finished process did not fail");
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 3) {
+        printf("needs at least 3 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    test_ring(size);
+    test_failing(size);
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+/**
+ * Checks Bcast and Reduce over MIMPI_COMM_WORLD, which go through shared
+ * memory: data of several chunks, waiting for the latest process and
+ * MIMPI_ERROR_REMOTE_FINISHED once a process has finalized. Usage:
+ *     mimpirun n examples_build/shm_collectives     (n >= 3)
+ * */
+#include "../mimpi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// More than one chunk of shared bufor.
+#define COUNT (200 * 1024 + 7)
+#define LATE_RANK 1
+#define LATE_SECONDS 1
+
+static int rank;
+static bool correct = true;
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static void test_data(int size) {
+    uint8_t *data = malloc(COUNT);
+    uint8_t *result = malloc(COUNT);
+    if (data == NULL || result == NULL)
+        exit(1);
+
+    for (int root = 0; root < size; root++) {
+        for (int i = 0; i < COUNT; i++)
+            data[i] = rank == root ? (uint8_t)(i * 7 + root) : 0;
+        check(MIMPI_Bcast(data, COUNT, root) == MIMPI_SUCCESS, "Bcast failed");
+
+        bool same = true;
+        for (int i = 0; i < COUNT; i++)
+            same &= data[i] == (uint8_t)(i * 7 + root);
+        check(same, "wrong data after Bcast");
+
+        for (int i = 0; i < COUNT; i++)
+            data[i] = (uint8_t)(i + rank);
+        check(MIMPI_Reduce(data, result, COUNT, MIMPI_SUM, root) == MIMPI_SUCCESS, "Reduce failed");
+
+        if (rank == root) {
+            same = true;
+            for (int i = 0; i < COUNT; i++)
+                same &= result[i] == (uint8_t)(size * i + size * (size - 1) / 2);
+            check(same, "wrong result of Reduce");
+        }
+    }
+
+    free(data);
+    free(result);
+}
+
+// Nobody leaves collective before the latest process comes.
+static void test_synchronisation() {
+    uint8_t data[16] = {0};
+
+    for (int reduce = 0; reduce < 2; reduce++) {
+        if (rank == LATE_RANK)
+            sleep(LATE_SECONDS);
+
+        double start = now();
+        MIMPI_Retcode result = reduce ? MIMPI_Reduce(data, data, sizeof(data), MIMPI_MAX, 0)
+                                      : MIMPI_Bcast(data, sizeof(data), 0);
+        check(result == MIMPI_SUCCESS, "collective failed");
+
+        if (rank != LATE_RANK)
+            check(now() - start > LATE_SECONDS * 0.9, reduce ? "Reduce did not wait for latest process"
+                                                             : "Bcast did not wait for latest process");
+    }
+}
+
+static void test_finished() {
+    uint8_t data[16] = {0};
+
+    check(MIMPI_Bcast(data, sizeof(data), 0) == MIMPI_ERROR_REMOTE_FINISHED,
+          "Bcast did not notice finished process");
+    check(MIMPI_Reduce(data, data, sizeof(data), MIMPI_MAX, 0) == MIMPI_ERROR_REMOTE_FINISHED,
+          "Reduce did not notice finished process");
+    check(MIMPI_Barrier() == MIMPI_ERROR_REMOTE_FINISHED,
+          "Barrier did not notice finished process");
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    if (size < 3) {
+        if (rank == 0)
+            printf("needs at least 3 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    test_data(size);
+    test_synchronisation();
+
+    if (rank != LATE_RANK)
+        test_finished();
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+/**
+ * Checks waking of blocked receive: process 0 and 1 play ping-pong, where
+ * process 1 sometimes answers at once (caught while spinning) and sometimes
+ * after a while (caught after going to sleep). No answer may be lost;
+ * time of all round trips is printed. Usage:
+ *     mimpirun 2 examples_build/spin_wakeup [spin budget]
+ * */
+#include "../mimpi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ROUNDS 2000
+#define SLOW_EVERY 100
+#define SLOW_US 2000
+#define TAG 9
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+    // Budget is read in MIMPI_Init.
+    if (argc > 1)
+        setenv("MIMPI_SPIN_BUDGET", argv[1], 1);
+
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    if (MIMPI_World_size() != 2) {
+        printf("needs exactly 2 processes\n");
+        MIMPI_Finalize();
+        return 1;
+    }
+
+    double start = now();
+    for (int round = 0; round < ROUNDS; round++) {
+        int value = round;
+
+        if (rank == 0) {
+            check(MIMPI_Send(&value, sizeof(int), 1, TAG) == MIMPI_SUCCESS, "Send failed");
+            check(MIMPI_Recv(&value, sizeof(int), 1, TAG) == MIMPI_SUCCESS, "Recv failed");
+            check(value == round + 1, "wrong answer");
+        } else {
+            check(MIMPI_Recv(&value, sizeof(int), 0, TAG) == MIMPI_SUCCESS, "Recv failed");
+            check(value == round, "wrong question");
+            if (round % SLOW_EVERY == 0)
+                usleep(SLOW_US);
+            value++;
+            check(MIMPI_Send(&value, sizeof(int), 0, TAG) == MIMPI_SUCCESS, "Send failed");
+        }
+    }
+
+    if (rank == 0)
+        printf("%d round trips in %.3f s\n", ROUNDS, now() - start);
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
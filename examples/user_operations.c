@@ -0,0 +1,135 @@
+/**
+ * Checks user defined operations: composition of affine maps (which is not
+ * commutative, so order of processes matters) and sum of ints, for several
+ * sizes and every root. Also checks that invalid operations are rejected
+ * and that freeing built-in operations does nothing. Usage:
+ *     mimpirun n examples_build/user_operations
+ * */
+#include "../mimpi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Map x -> x * mul + add.
+struct affine_t {
+    uint64_t mul;
+    uint64_t add;
+};
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+// First applies map of inout, then map of in.
+static void compose(void *inout, void const *in, int count) {
+    struct affine_t *first = inout;
+    struct affine_t const *second = in;
+    for (int i = 0; i < count; i++) {
+        first[i].add = first[i].add * second[i].mul + second[i].add;
+        first[i].mul *= second[i].mul;
+    }
+}
+
+static void int_sum(void *inout, void const *in, int count) {
+    int *result = inout;
+    int const *values = in;
+    for (int i = 0; i < count; i++)
+        result[i] += values[i];
+}
+
+static struct affine_t affine(int process, int i) {
+    return (struct affine_t){.mul = process * 2 + 3 + i, .add = process + 7 * i};
+}
+
+static void test_invalid() {
+    MIMPI_Op op = MIMPI_OP_NULL;
+    check(MIMPI_Op_create(int_sum, 0, true, &op) == MIMPI_ERROR_NO_SUCH_OP, "element size 0 accepted");
+    check(MIMPI_Op_create(int_sum, -4, true, &op) == MIMPI_ERROR_NO_SUCH_OP, "negative element size accepted");
+    check(MIMPI_Op_create(NULL, 4, true, &op) == MIMPI_ERROR_NO_SUCH_OP, "NULL function accepted");
+    check(op == MIMPI_OP_NULL, "rejected operation was created");
+
+    MIMPI_Op sum = MIMPI_SUM;
+    MIMPI_Op_free(&sum);
+    MIMPI_Op_free(&op);
+    check(sum == MIMPI_SUM && op == MIMPI_OP_NULL, "freeing not user operation changed it");
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+
+    test_invalid();
+
+    MIMPI_Op compose_op, sum_op;
+    check(MIMPI_Op_create(compose, sizeof(struct affine_t), false, &compose_op) == MIMPI_SUCCESS, "Op_create failed");
+    check(MIMPI_Op_create(int_sum, sizeof(int), true, &sum_op) == MIMPI_SUCCESS, "Op_create failed");
+
+    int counts[] = {1, 3, 5000, 20000};
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        int count = counts[c];
+        struct affine_t *maps = malloc(count * sizeof(struct affine_t));
+        struct affine_t *composed = malloc(count * sizeof(struct affine_t));
+        int *values = malloc(count * sizeof(int));
+        int *sums = malloc(count * sizeof(int));
+        if (maps == NULL || composed == NULL || values == NULL || sums == NULL)
+            return 1;
+
+        for (int i = 0; i < count; i++) {
+            maps[i] = affine(rank, i);
+            values[i] = rank * 100000 + i;
+        }
+
+        for (int root = 0; root < size; root++) {
+            check(MIMPI_Reduce(maps, composed, count * sizeof(struct affine_t), compose_op, root) == MIMPI_SUCCESS,
+                  "Reduce with composition failed");
+            check(MIMPI_Reduce(values, sums, count * sizeof(int), sum_op, root) == MIMPI_SUCCESS,
+                  "Reduce with sum failed");
+
+            if (rank != root)
+                continue;
+
+            bool same = true;
+            for (int i = 0; i < count; i++) {
+                struct affine_t map = affine(0, i);
+                for (int k = 1; k < size; k++) {
+                    struct affine_t next = affine(k, i);
+                    compose(&map, &next, 1);
+                }
+                same &= composed[i].mul == map.mul && composed[i].add == map.add;
+                same &= sums[i] == 100000 * (size * (size - 1) / 2) + size * i;
+            }
+            check(same, "wrong result of Reduce");
+        }
+
+        free(maps);
+        free(composed);
+        free(values);
+        free(sums);
+    }
+
+    MIMPI_Op freed = compose_op;
+    MIMPI_Op_free(&compose_op);
+    check(compose_op == MIMPI_OP_NULL, "Op_free did not clear handle");
+
+    // Freed id is reused by next operation.
+    MIMPI_Op reused;
+    check(MIMPI_Op_create(int_sum, sizeof(int), true, &reused) == MIMPI_SUCCESS, "Op_create failed");
+    check(reused == freed, "id of freed operation was not reused");
+    MIMPI_Op_free(&reused);
+    MIMPI_Op_free(&sum_op);
+
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+/**
+ * Checks one-sided windows: Put to next process, Accumulate by everyone
+ * into the same byte of every window, Get after fence and counter kept
+ * under lock. Usage:
+ *     mimpirun n examples_build/windows
+ * */
+#include "../mimpi.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define WINDOW_SIZE 64
+#define ACCUMULATES 50
+#define SUM_OFFSET 63
+#define COUNTER_OFFSET 40
+
+static int rank;
+static bool correct = true;
+
+static void check(bool condition, char const *what) {
+    if (!condition) {
+        printf("process %d: %s\n", rank, what);
+        correct = false;
+    }
+}
+
+int main(int argc, char **argv) {
+    MIMPI_Init(false);
+
+    rank = MIMPI_World_rank();
+    int size = MIMPI_World_size();
+    int next = (rank + 1) % size;
+    int previous = (rank + size - 1) % size;
+
+    // Windows of processes may differ in size.
+    uint8_t *base;
+    MIMPI_Win win;
+    check(MIMPI_Win_allocate(WINDOW_SIZE + rank, MIMPI_COMM_WORLD, (void **)&base, &win) == MIMPI_SUCCESS,
+          "Win_allocate failed");
+    memset(base, 0, WINDOW_SIZE + rank);
+    check(MIMPI_Win_fence(win) == MIMPI_SUCCESS, "Win_fence failed");
+
+    uint8_t own = (uint8_t)(rank + 1);
+    check(MIMPI_Put(&own, 1, next, rank, win) == MIMPI_SUCCESS, "Put failed");
+    for (int target = 0; target < size; target++)
+        for (int i = 0; i < ACCUMULATES; i++)
+            check(MIMPI_Accumulate(&own, 1, MIMPI_SUM, target, SUM_OFFSET, win) == MIMPI_SUCCESS, "Accumulate failed");
+    check(MIMPI_Put(&own, 1, size, 0, win) == MIMPI_ERROR_NO_SUCH_RANK, "Put to process out of world did not fail");
+    check(MIMPI_Win_fence(win) == MIMPI_SUCCESS, "Win_fence failed");
+
+    uint8_t expected = 0;
+    for (int i = 0; i < size; i++)
+        expected += ACCUMULATES * (i + 1);
+    check(base[previous] == (uint8_t)(previous + 1), "wrong data put by previous process");
+    check(base[SUM_OFFSET] == expected, "wrong result of Accumulate");
+
+    uint8_t got = 0;
+    check(MIMPI_Get(&got, 1, next, SUM_OFFSET, win) == MIMPI_SUCCESS, "Get failed");
+    check(got == expected, "wrong data got from next process");
+
+    // Increments under lock are not lost.
+    check(MIMPI_Win_lock(0, win) == MIMPI_SUCCESS, "Win_lock failed");
+    uint8_t counter;
+    MIMPI_Get(&counter, 1, 0, COUNTER_OFFSET, win);
+    counter++;
+    MIMPI_Put(&counter, 1, 0, COUNTER_OFFSET, win);
+    check(MIMPI_Win_unlock(0, win) == MIMPI_SUCCESS, "Win_unlock failed");
+
+    check(MIMPI_Win_fence(win) == MIMPI_SUCCESS, "Win_fence failed");
+    if (rank == 0)
+        check(base[COUNTER_OFFSET] == size, "increments under lock were lost");
+
+    check(MIMPI_Win_free(&win) == MIMPI_SUCCESS, "Win_free failed");
+    MIMPI_Finalize();
+
+    if (correct)
+        printf("process %d: OK\n", rank);
+    return correct ? 0 : 1;
+}
@@ -13,9 +13,21 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #define META_DATA_MINI_BUFOR_SIZE 320
 
+// Count of awaited messege meaning that any count matches (probing).
+#define ANY_COUNT (-1)
+
 static int pow2[8] = {1, 2, 4, 8, 16, 32, 64, 128};
 
 // Highest power of 2, not bigger than x.
@@ -35,6 +47,7 @@ static int lowest_used_bit(int x) {
 }
 
 static int min(int a, int b) { return b > a ? a : b; }
+static int max(int a, int b) { return b > a ? b : a; }
 
 // Holds information if n-th process ended.
 static bool has_ended[N];
@@ -44,8 +57,15 @@ static int world_rank = -1;
 static int world_size = -1;
 
 static bool deadlock_detection;
+static MIMPI_Progress progress_mode;
 static int deadlock_detection_messege_cnt = 0;
 
+// Reduce sends data in segments of this size, so that reducing one segment
+// overlaps with transfer of the next one.
+#define REDUCE_SEGMENT_VAR "MIMPI_REDUCE_SEGMENT"
+#define DEFAULT_REDUCE_SEGMENT (64 * 1024)
+static int reduce_segment_size;
+
 enum messege_type_t {
     PtP_messege,
     Process_ended,
@@ -54,26 +74,36 @@ enum messege_type_t {
     Barrier,
     Bcast,
     Reduction,
+    Allgather,
+    Scan,
+    Large_credit,
+    Collective_progress,    // Never sent, wakes main program waiting for nonblocking collective.
 };
 
 struct meta_data_t {
     enum messege_type_t messege_type;
+    int context;
     int from;
     int count;
     int tag;
     int deadlock_cnt1;
     int deadlock_cnt2;
+    bool count_is_limit;    // In awaited messege: any count up to this one matches.
 };
 
 // meta_data_t with bufor that is neccessary for time optimalisation.
 struct meta_data_being_send_t {
     enum messege_type_t messege_type;
+    int context;
     int from;
     int count_here;
     int count_not_here;
+    int count_uncompressed;     // -1 if data is not compressed.
     int tag;
     int deadlock_cnt1;
     int deadlock_cnt2;
+    int sender;                 // Process that wrote header (from differs for answers).
+    int lane_seq;               // Headers sent by sender through data channel before.
     uint8_t mini_bufor[META_DATA_MINI_BUFOR_SIZE];
 };
 
@@ -84,12 +114,485 @@ struct messege_t {
     struct messege_t *prev_messege;
 };
 
+// Neighbour of process in communicator with topology. Messeges sent to it
+// are tagged with send_tag, the ones received from it with recv_tag.
+struct neighbor_t {
+    int rank;   // Rank in communicator or MIMPI_UNDEFINED.
+    int send_tag;
+    int recv_tag;
+};
+
+// Communicator - group of processes with its own ranks and messege context.
+struct comm_t {
+    int context;
+    int rank;
+    int size;
+    int *world_ranks;   // Translation of rank in communicator to world rank.
+
+    int neighbors_cnt;
+    struct neighbor_t *neighbors;
+
+    int collectives_started;    // Nonblocking ones, numbers them.
+};
+
+static struct comm_t world_comm;
+MIMPI_Comm const MIMPI_COMM_WORLD = &world_comm;
+
+// Neighbourhood and nonblocking collective traffic has its own context, so it
+// doesn't mix with messeges of blocking operations within the same communicator.
+static int internal_context(MIMPI_Comm comm) {
+    return -comm->context - 1;
+}
+
+// Context that will be given to next created communicator.
+static int next_context = 1;
+
+// ---- BEGIN Implementation of process groups.
+
+// Processes can be split into groups (e.g. hosts), so that collectives over
+// MIMPI_COMM_WORLD send as little as possible between groups.
+// MIMPI_GROUPS gives group of each process, e.g. "0,0,1,1". Sends to other
+// groups can be delayed by MIMPI_GROUP_DELAY milliseconds per 512 bytes.
+#define GROUPS_VAR "MIMPI_GROUPS"
+#define GROUP_DELAY_VAR "MIMPI_GROUP_DELAY"
+
+// hierarchical - whether groups are given
+// group_of     - group of every process
+// group_comm   - processes of own group; leader (lowest world rank) has rank 0
+// leaders_comm - leaders of all groups; rank is MIMPI_UNDEFINED in others
+static bool hierarchical = false;
+static int group_of[N];
+static struct comm_t group_comm;
+static struct comm_t leaders_comm;
+
+static bool is_leader(int rank) {
+    for (int i = 0; i < rank; i++)
+        if (group_of[i] == group_of[rank])
+            return false;
+    return true;
+}
+
+// Rank in leaders_comm of leader of group.
+static int leader_of_group(int group) {
+    for (int i = 0; i < leaders_comm.size; i++)
+        if (group_of[leaders_comm.world_ranks[i]] == group)
+            return i;
+    return MIMPI_UNDEFINED;
+}
+
+static void setup_groups() {
+    char *groups_env = getenv(GROUPS_VAR);
+    if (groups_env == NULL)
+        return;
+
+    char *groups_str = strdup(groups_env);
+    ASSERT_ZERO(groups_str == NULL);
+
+    int groups_cnt = 0;
+    for (char *group = strtok(groups_str, ","); group != NULL; group = strtok(NULL, ",")) {
+        if (groups_cnt == world_size)
+            fatal("%s gives groups of more than %d processes", GROUPS_VAR, world_size);
+        group_of[groups_cnt++] = string_to_no(group);
+    }
+    free(groups_str);
+
+    if (groups_cnt != world_size)
+        fatal("%s gives groups of %d processes instead of %d", GROUPS_VAR, groups_cnt, world_size);
+
+    hierarchical = true;
+
+    // Both communicators are built the same way everywhere, so contexts
+    // can be assigned without communication.
+    group_comm.context = next_context++;
+    group_comm.size = 0;
+    group_comm.world_ranks = malloc(world_size * sizeof(int));
+    ASSERT_ZERO(group_comm.world_ranks == NULL);
+
+    leaders_comm.context = next_context++;
+    leaders_comm.size = 0;
+    leaders_comm.rank = MIMPI_UNDEFINED;
+    leaders_comm.world_ranks = malloc(world_size * sizeof(int));
+    ASSERT_ZERO(leaders_comm.world_ranks == NULL);
+
+    for (int i = 0; i < world_size; i++) {
+        if (group_of[i] == group_of[world_rank]) {
+            if (i == world_rank)
+                group_comm.rank = group_comm.size;
+            group_comm.world_ranks[group_comm.size++] = i;
+        }
+
+        if (is_leader(i)) {
+            if (i == world_rank)
+                leaders_comm.rank = leaders_comm.size;
+            leaders_comm.world_ranks[leaders_comm.size++] = i;
+        }
+    }
+
+    char *delay_str = getenv(GROUP_DELAY_VAR);
+    if (delay_str != NULL) {
+        int delay_ms = string_to_no(delay_str);
+        for (int i = 0; i < world_size; i++) {
+            if (group_of[i] != group_of[world_rank]) {
+                channel_set_delay(OUT + world_rank * world_size + i, delay_ms);
+                channel_set_delay(OUT + i * world_size + i, delay_ms);
+            }
+        }
+    }
+}
+
+// ---- END Implementation of process groups.
+
+// ---- BEGIN Implementation of user defined operations.
+
+struct user_op_t {
+    MIMPI_User_function function;
+    int element_size;
+    bool commutative;
+    bool used;
+};
+
+// Operation op (op >= USER_OP_BASE) is user_ops[op - USER_OP_BASE].
+#define USER_OP_BASE (MIMPI_PROD + 1)
+static struct user_op_t *user_ops = NULL;
+static int user_ops_cnt = 0;
+
+static struct user_op_t *user_op(MIMPI_Op op) {
+    if (op < USER_OP_BASE)
+        return NULL;
+    return &user_ops[op - USER_OP_BASE];
+}
+
+static int op_element_size(MIMPI_Op op) {
+    return op < USER_OP_BASE ? 1 : user_op(op)->element_size;
+}
+
+static bool op_commutative(MIMPI_Op op) {
+    return op < USER_OP_BASE ? true : user_op(op)->commutative;
+}
+
+MIMPI_Retcode MIMPI_Op_create(
+    MIMPI_User_function function,
+    int element_size,
+    bool commutative,
+    MIMPI_Op *op
+) {
+    if (function == NULL || element_size <= 0)
+        return MIMPI_ERROR_NO_SUCH_OP;
+
+    // Ids are reused, so processes creating operations in the same order
+    // get the same ids.
+    int id = 0;
+    while (id < user_ops_cnt && user_ops[id].used)
+        id++;
+
+    if (id == user_ops_cnt) {
+        user_ops = realloc(user_ops, (user_ops_cnt + 1) * sizeof(struct user_op_t));
+        ASSERT_ZERO(user_ops == NULL);
+        user_ops_cnt++;
+    }
+
+    user_ops[id].function = function;
+    user_ops[id].element_size = element_size;
+    user_ops[id].commutative = commutative;
+    user_ops[id].used = true;
+
+    *op = USER_OP_BASE + id;
+    return MIMPI_SUCCESS;
+}
+
+void MIMPI_Op_free(MIMPI_Op *op) {
+    // Built-in operations and MIMPI_OP_NULL are left untouched.
+    if (*op < USER_OP_BASE || *op - USER_OP_BASE >= user_ops_cnt)
+        return;
+
+    user_op(*op)->used = false;
+    *op = MIMPI_OP_NULL;
+}
+
+// ---- END Implementation of user defined operations.
+
+// ---- BEGIN Implementation of derived datatypes.
+
+// Datatype is flattened to list of contiguous blocks of bytes. Element i
+// of data of given type starts extent * i bytes after beginning of data.
+// MIMPI_BYTE (NULL) is a single byte.
+struct type_block_t {
+    int offset;
+    int length;
+};
+
+struct datatype_t {
+    struct type_block_t *blocks;
+    int blocks_cnt;
+    int size;       // Sum of lengths of blocks.
+    int extent;
+};
+
+static struct type_block_t byte_block = {.offset = 0, .length = 1};
+static struct datatype_t byte_type = {.blocks = &byte_block, .blocks_cnt = 1, .size = 1, .extent = 1};
+
+static struct datatype_t *type_of(MIMPI_Datatype type) {
+    return type == MIMPI_BYTE ? &byte_type : type;
+}
+
+// Whether data of type is just its bytes one after another.
+static bool type_contiguous(MIMPI_Datatype type) {
+    struct datatype_t *t = type_of(type);
+    return t->blocks_cnt == 0 || (t->blocks_cnt == 1 && t->blocks[0].offset == 0 && t->blocks[0].length == t->extent);
+}
+
+static void type_add_block(struct datatype_t *type, int *capacity, int offset, int length) {
+    type->size += length;
+    type->extent = max(type->extent, offset + length);
+
+    if (type->blocks_cnt > 0) {
+        struct type_block_t *last = &type->blocks[type->blocks_cnt - 1];
+        if (last->offset + last->length == offset) {
+            last->length += length;
+            return;
+        }
+    }
+
+    if (type->blocks_cnt == *capacity) {
+        *capacity = 2 * *capacity + 1;
+        type->blocks = realloc(type->blocks, *capacity * sizeof(struct type_block_t));
+        ASSERT_ZERO(type->blocks == NULL);
+    }
+
+    type->blocks[type->blocks_cnt++] = (struct type_block_t){.offset = offset, .length = length};
+}
+
+// Every datatype is built as blocklengths[i] elements of types[i] placed
+// one after another from byte displacements[i].
+static void type_create(
+    int count,
+    int const *blocklengths,
+    int const *displacements,
+    MIMPI_Datatype const *types,
+    MIMPI_Datatype *newtype
+) {
+    struct datatype_t *type = malloc(sizeof(struct datatype_t));
+    ASSERT_ZERO(type == NULL);
+    *type = (struct datatype_t){.blocks = NULL, .blocks_cnt = 0, .size = 0, .extent = 0};
+    int capacity = 0;
+
+    for (int i = 0; i < count; i++) {
+        struct datatype_t *old = type_of(types[i]);
+        if (blocklengths[i] < 0 || displacements[i] < 0)
+            fatal("Negative block length or displacement in datatype\n");
+
+        for (int j = 0; j < blocklengths[i]; j++)
+            for (int k = 0; k < old->blocks_cnt; k++)
+                type_add_block(type, &capacity, displacements[i] + j * old->extent + old->blocks[k].offset, old->blocks[k].length);
+    }
+
+    *newtype = type;
+}
+
+MIMPI_Retcode MIMPI_Type_vector(
+    int count,
+    int blocklength,
+    int stride,
+    MIMPI_Datatype oldtype,
+    MIMPI_Datatype *newtype
+) {
+    int *blocklengths = malloc(count * sizeof(int));
+    int *displacements = malloc(count * sizeof(int));
+    MIMPI_Datatype *types = malloc(count * sizeof(MIMPI_Datatype));
+    ASSERT_ZERO(count > 0 && (blocklengths == NULL || displacements == NULL || types == NULL));
+
+    for (int i = 0; i < count; i++) {
+        blocklengths[i] = blocklength;
+        displacements[i] = i * stride * type_of(oldtype)->extent;
+        types[i] = oldtype;
+    }
+
+    type_create(count, blocklengths, displacements, types, newtype);
+
+    free(blocklengths);
+    free(displacements);
+    free(types);
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Type_indexed(
+    int count,
+    int const *blocklengths,
+    int const *displacements,
+    MIMPI_Datatype oldtype,
+    MIMPI_Datatype *newtype
+) {
+    int *byte_displacements = malloc(count * sizeof(int));
+    MIMPI_Datatype *types = malloc(count * sizeof(MIMPI_Datatype));
+    ASSERT_ZERO(count > 0 && (byte_displacements == NULL || types == NULL));
+
+    for (int i = 0; i < count; i++) {
+        byte_displacements[i] = displacements[i] * type_of(oldtype)->extent;
+        types[i] = oldtype;
+    }
+
+    type_create(count, blocklengths, byte_displacements, types, newtype);
+
+    free(byte_displacements);
+    free(types);
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Type_create_struct(
+    int count,
+    int const *blocklengths,
+    int const *displacements,
+    MIMPI_Datatype const *types,
+    MIMPI_Datatype *newtype
+) {
+    type_create(count, blocklengths, displacements, types, newtype);
+    return MIMPI_SUCCESS;
+}
+
+void MIMPI_Type_free(MIMPI_Datatype *type) {
+    if (*type != MIMPI_BYTE) {
+        free((*type)->blocks);
+        free(*type);
+    }
+    *type = MIMPI_BYTE;
+}
+
+int MIMPI_Type_size(MIMPI_Datatype type) {
+    return type_of(type)->size;
+}
+
+// Walks through contiguous pieces of count elements of type at base.
+struct type_iter_t {
+    struct datatype_t *type;
+    uint8_t *base;
+    int count;
+    int element;
+    int block;
+    int done;       // Bytes of current block already walked through.
+};
+
+static struct type_iter_t type_iter(MIMPI_Datatype type, void const *base, int count) {
+    return (struct type_iter_t){.type = type_of(type), .base = (uint8_t *)base, .count = count};
+}
+
+// Gives next piece of at most max bytes, returns its length (0 at the end).
+static int type_iter_next(struct type_iter_t *iter, int max, uint8_t **piece) {
+    struct datatype_t *type = iter->type;
+    if (iter->element >= iter->count || type->blocks_cnt == 0)
+        return 0;
+
+    struct type_block_t *block = &type->blocks[iter->block];
+    *piece = iter->base + (size_t)iter->element * type->extent + block->offset + iter->done;
+    int length = min(block->length - iter->done, max);
+
+    iter->done += length;
+    if (iter->done == block->length) {
+        iter->done = 0;
+        if (++iter->block == type->blocks_cnt) {
+            iter->block = 0;
+            iter->element++;
+        }
+    }
+
+    return length;
+}
+
+// Copies length bytes between contiguous bufor and next pieces of iter.
+static void type_iter_copy(struct type_iter_t *iter, uint8_t *bufor, int length, bool to_pieces) {
+    uint8_t *piece;
+    int piece_length;
+
+    while (length > 0 && (piece_length = type_iter_next(iter, length, &piece)) > 0) {
+        if (to_pieces)
+            memcpy(piece, bufor, piece_length);
+        else
+            memcpy(bufor, piece, piece_length);
+        bufor += piece_length;
+        length -= piece_length;
+    }
+}
+
+// ---- END Implementation of derived datatypes.
+
+// ---- BEGIN Implementation of live counters.
+
+// Counters of this process (see struct stats_t). Without mimpirun they
+// go to stats_local, so that they can always be updated.
+static struct stats_rank_t stats_local;
+static struct stats_rank_t *stats = &stats_local;
+static struct stats_t *stats_shared = NULL;
+
+static void stats_add(atomic_llong *counter, long long value) {
+    atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+// Notes what process is blocked on, peer being world rank (-1 if none or any).
+static void stats_block(enum stats_call_t call, int peer) {
+    atomic_store_explicit(&stats->call, call, memory_order_relaxed);
+    atomic_store_explicit(&stats->peer, peer < 0 ? -1 : peer, memory_order_relaxed);
+}
+
+// Notes send to peer blocking, unless process is blocked on something else
+// (handler thread sends while main program waits). Returns whether it did.
+static bool stats_block_send(int peer) {
+    int expected = Stats_none;
+    if (!atomic_compare_exchange_strong_explicit(&stats->call, &expected, Stats_send,
+                                                 memory_order_relaxed, memory_order_relaxed))
+        return false;
+
+    atomic_store_explicit(&stats->peer, peer, memory_order_relaxed);
+    return true;
+}
+
+static void stats_unblock_send(bool blocked) {
+    int expected = Stats_send;
+    if (blocked)
+        atomic_compare_exchange_strong_explicit(&stats->call, &expected, Stats_none,
+                                                memory_order_relaxed, memory_order_relaxed);
+}
+
+static long long stats_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void stats_init() {
+    // Programs not started by mimpirun have no counters memory.
+    if (fcntl(STATS_DESC, F_GETFD) == -1)
+        return;
+
+    stats_shared = mmap(NULL, sizeof(struct stats_t), PROT_READ | PROT_WRITE, MAP_SHARED, STATS_DESC, 0);
+    ASSERT_ZERO(stats_shared == MAP_FAILED);
+    ASSERT_SYS_OK(close(STATS_DESC));
+
+    stats = &stats_shared->ranks[world_rank];
+    atomic_store(&stats->pid, getpid());
+}
+
+static void stats_finalize() {
+    if (stats_shared == NULL)
+        return;
+
+    stats_block(Stats_none, -1);
+    atomic_store(&stats->ended, 1);
+
+    ASSERT_SYS_OK(munmap(stats_shared, sizeof(struct stats_t)));
+    stats_shared = NULL;
+    stats = &stats_local;
+}
+
+// ---- END Implementation of live counters.
+
 // ---- BEGIN Implementation of list of messeges.
 
 static struct messege_t *first_messege = NULL;
 static struct messege_t *last_messege = NULL;
 
 static void add_messege_to_list(struct messege_t *messege) {
+    stats_add(&stats->unexpected_cnt, 1);
+    stats_add(&stats->unexpected_bytes, messege->info.count);
+
     if (first_messege == NULL) {
         first_messege = last_messege = messege;
         messege->prev_messege = NULL;
@@ -102,7 +605,15 @@ static void add_messege_to_list(struct messege_t *messege) {
     }
 }
 
-static void remove_messege_from_list(struct messege_t *messege) {
+static void free_messege(struct messege_t *messege) {
+    free(messege->data);
+    free(messege);
+}
+
+static void take_messege_from_list(struct messege_t *messege) {
+    stats_add(&stats->unexpected_cnt, -1);
+    stats_add(&stats->unexpected_bytes, -messege->info.count);
+
     if (messege->prev_messege == NULL) {
         first_messege = messege->next_messege;
     } else {
@@ -114,42 +625,180 @@ static void remove_messege_from_list(struct messege_t *messege) {
     } else {
         messege->next_messege->prev_messege = messege->prev_messege;
     }
-    free(messege->data);
-    free(messege);
+}
+
+static void remove_messege_from_list(struct messege_t *messege) {
+    take_messege_from_list(messege);
+    free_messege(messege);
 }
 
 // ---- END Implementation of list of messeges.
 
-// messege_handel_thread - thread that handles all incoming messeges
+enum request_kind_t {
+    Send_request,
+    Recv_request,
+    Collective_request,
+};
+
+// State of nonblocking collective. It goes through steps, each of which
+// consists of optional send and optional receive (see collective_step).
+// Only the thread that set advancing may change it.
+struct collective_t {
+    enum messege_type_t type;
+    int root;
+    MIMPI_Op op;
+    int count;
+    int tag;            // Number of collective in communicator.
+    uint8_t *data;      // Data sent and received.
+    void *recv_data;    // Reduce: place for result in root.
+    bool own_data;      // Whether data is a copy to be freed.
+
+    int step;
+    bool sent;          // Send of current step is done.
+    bool advancing;     // Some thread is advancing collective right now.
+    bool again;         // Something came while other thread was advancing.
+    bool needs_main;    // Handler couldn't send big messege on its own.
+
+    struct meta_data_t recv_key;    // Messege awaited in current step.
+    struct meta_data_t wake_key;    // Main program waits on it for progress.
+};
+
+// Persistent point-to-point request (see MIMPI_Send_init / MIMPI_Recv_init)
+// or nonblocking collective (see MIMPI_Ibarrier and others).
+struct request_t {
+    enum request_kind_t kind;
+    MIMPI_Comm comm;
+    int peer;       // World rank or MIMPI_ANY_SOURCE.
+    void *data;
+    bool active;    // Started and not yet waited for.
+    bool posted;    // Receive slot is in posted requests list.
+    bool completed;
+    MIMPI_Retcode result;
+
+    struct meta_data_t info;                // Matching key of receive.
+    struct meta_data_t received;            // Header of messege that matched.
+    MIMPI_Datatype type;                    // Layout of data of receive.
+    int type_count;
+    struct meta_data_being_send_t header;   // Header of send, built once.
+    struct collective_t coll;
+
+    struct request_t *next_request;
+    struct request_t *prev_request;
+};
+
+// ---- BEGIN Implementation of list of posted requests.
+
+static struct request_t *first_request = NULL;
+static struct request_t *last_request = NULL;
+
+static void add_request_to_list(struct request_t *request) {
+    request->posted = true;
+    request->next_request = NULL;
+    request->prev_request = last_request;
+
+    if (first_request == NULL)
+        first_request = request;
+    else
+        last_request->next_request = request;
+
+    last_request = request;
+}
+
+static void remove_request_from_list(struct request_t *request) {
+    if (request->prev_request == NULL) {
+        first_request = request->next_request;
+    } else {
+        request->prev_request->next_request = request->next_request;
+    }
+
+    if (request->next_request == NULL) {
+        last_request = request->prev_request;
+    } else {
+        request->next_request->prev_request = request->prev_request;
+    }
+    request->posted = false;
+}
+
+// ---- END Implementation of list of posted requests.
+
+// messege_handel_thread - thread that handles all incoming messeges (not used in polling modes)
 // mutex                 - blocks access to shared data (messege list and waitline)
 static pthread_t messege_handler_thread;
 static pthread_mutex_t mutex;
 
-// wait_line_mutex - mutex to hold main program if wanted messege has not come yet
-// wait_line       - holds type of messege that main program is waiting for
-// wanted_messege  - place to save messege that main program was waiting for
-static pthread_mutex_t wait_line_mutex;
+// wake_state     - futex word on which main program waits for wanted messege
+// spin_budget    - how many times main program checks wake_state before sleeping
+// wait_line      - holds type of messege that main program is waiting for
+// wanted_messege - place to save messege that main program was waiting for
+enum wake_state_t {
+    Not_woken,
+    Sleeping,
+    Woken,
+};
+static atomic_int wake_state = Not_woken;
+static int spin_budget;
 static struct meta_data_t *wait_line = NULL;
 static struct messege_t *wanted_messege = NULL;
 
-static int read_loop(int desc, void *data, int size) {
-    int bytes_read = 0;
-    int bytes_left_to_read = size;
-    int read_result;
+#define SPIN_BUDGET_VAR "MIMPI_SPIN_BUDGET"
+#define DEFAULT_SPIN_BUDGET 2000
 
-    while (bytes_left_to_read > 0) {
-        read_result = chrecv(desc, data + bytes_read, bytes_left_to_read);
+// Wakes main program after wanted_messege was set. Requires mutex to be held.
+static void wake_main_thread() {
+    // In polling modes main program notices wanted_messege itself.
+    if (progress_mode == MIMPI_PROGRESS_THREAD && atomic_exchange(&wake_state, Woken) == Sleeping)
+        futex_wake(&wake_state, 1);
+}
 
-        if (read_result == -1 || read_result == 0)
-            return -1;
+// Spins for a while, as answer usually comes quickly, then sleeps on futex.
+static void wait_for_wake() {
+    for (int i = 0; i < spin_budget; i++)
+        if (atomic_load_explicit(&wake_state, memory_order_acquire) == Woken)
+            return;
 
-        bytes_read += read_result;
-        bytes_left_to_read -= read_result;
+    int expected = Not_woken;
+    if (atomic_compare_exchange_strong(&wake_state, &expected, Sleeping))
+        while (atomic_load(&wake_state) == Sleeping)
+            futex_wait(&wake_state, Sleeping);
+}
+
+// In polling modes data channels are nonblocking and write, that didn't fit
+// into channel, is finished while reading other messeges. Otherwise two
+// processes sending big messeges to each other would wait forever.
+static struct {
+    int desc;
+    const void *data;
+    int left;
+    bool failed;
+} pending_write;
+
+static void flush_pending_write() {
+    if (pending_write.left == 0)
+        return;
+
+    int write_result = chsend(pending_write.desc, pending_write.data, pending_write.left);
+
+    if (write_result == -1 && errno == EAGAIN)
+        return;
+
+    if (write_result == -1) {
+        pending_write.left = 0;
+        pending_write.failed = true;
+        return;
     }
 
-    return 0;
+    pending_write.data += write_result;
+    pending_write.left -= write_result;
+}
+
+static int poll_timeout() {
+    return progress_mode == MIMPI_PROGRESS_BUSY_POLL ? 0 : -1;
 }
 
+static void progress_pending();
+static bool progress_control();
+static int receive_poll_descs(struct pollfd *poll_desc, int *ranks);
+
 static int write_loop(int desc, const void *data, int size) {
     if (data == NULL || size == 0)
         return 0;
@@ -161,6 +810,27 @@ static int write_loop(int desc, const void *data, int size) {
     while (bytes_left_to_write > 0) {
         write_result = chsend(desc, data + bytes_wrote, bytes_left_to_write);
 
+        // Only in polling modes, where data channels are nonblocking.
+        if (write_result == -1 && errno == EAGAIN) {
+            pending_write.desc = desc;
+            pending_write.data = data + bytes_wrote;
+            pending_write.left = bytes_left_to_write;
+            pending_write.failed = false;
+
+            while (pending_write.left > 0) {
+                struct pollfd poll_desc[N + 3];
+                int ranks[N + 3];
+                poll_desc[0] = (struct pollfd){.fd = desc, .events = POLLOUT};
+                int poll_cnt = 1 + receive_poll_descs(poll_desc + 1, ranks);
+
+                ASSERT_SYS_OK(poll(poll_desc, poll_cnt, poll_timeout()));
+                progress_pending();
+                flush_pending_write();
+            }
+
+            return pending_write.failed ? -1 : 0;
+        }
+
         if (write_result == -1)
             return -1;
 
@@ -171,88 +841,454 @@ static int write_loop(int desc, const void *data, int size) {
     return 0;
 }
 
-static int send_messege(int where_to_rank, struct meta_data_t *info, const void *data) {
-    if (has_ended[where_to_rank])
-        return -1;
-
-    struct meta_data_being_send_t info2 = {
-        .messege_type   = info->messege_type,
-        .from           = info->from,
-        .count_here     =               min(info->count, META_DATA_MINI_BUFOR_SIZE),
-        .count_not_here = info->count - min(info->count, META_DATA_MINI_BUFOR_SIZE),
-        .tag            = info->tag,
-        .deadlock_cnt1  = info->deadlock_cnt1,
-        .deadlock_cnt2  = info->deadlock_cnt2
-    };
+#define IOV_BATCH 64
 
-    if (data != NULL)
-        memcpy(&info2.mini_bufor, data, info2.count_here);
+// Fills at most IOV_BATCH vectors with next pieces of iter, up to size bytes.
+static int fill_iov(struct type_iter_t *iter, struct iovec *iov, int size) {
+    int iov_cnt = 0;
+    uint8_t *piece;
+    int length;
 
-    int send_return = chsend(OUT + where_to_rank * world_size + where_to_rank, &info2, sizeof(struct meta_data_being_send_t));
+    while (iov_cnt < IOV_BATCH && size > 0 && (length = type_iter_next(iter, size, &piece)) > 0) {
+        iov[iov_cnt++] = (struct iovec){.iov_base = piece, .iov_len = length};
+        size -= length;
+    }
 
-    if (send_return == -1)
-        return -1;
+    return iov_cnt;
+}
 
-    // Assert atomicity of messege < 512 bytes.
-    ASSERT_ZERO(send_return - sizeof(struct meta_data_being_send_t));
+// Writes rest of data, that didn't fit into channel, through write_loop,
+// which finishes it while reading other messeges (only in polling modes).
+// That needs contiguous data, so rest is packed.
+static int write_packed_rest(int desc, struct iovec *iov, int iov_cnt, struct type_iter_t *iter, int size) {
+    uint8_t *rest = malloc(size);
+    ASSERT_ZERO(rest == NULL);
+
+    int packed = 0;
+    for (int i = 0; i < iov_cnt; i++) {
+        memcpy(rest + packed, iov[i].iov_base, iov[i].iov_len);
+        packed += iov[i].iov_len;
+    }
+    type_iter_copy(iter, rest + packed, size - packed, false);
 
-    return write_loop(
-            OUT + world_rank * world_size + where_to_rank, 
-            data + info2.count_here,
-            info2.count_not_here
-        );
+    int result = write_loop(desc, rest, size);
+    free(rest);
+    return result;
 }
 
-static bool messege_match(struct meta_data_t *messege, struct meta_data_t *waiting) {
-    if (messege == NULL || waiting == NULL)
-        return false;
+// Writes size bytes of pieces of iter, many pieces at once. When channel
+// is full, write_loop, which knows how to wait, takes over.
+static int writev_loop(int desc, struct type_iter_t *iter, int size) {
+    struct iovec iov[IOV_BATCH];
 
-    if (messege->messege_type == waiting->messege_type &&
-        messege->from == waiting->from &&
-        messege->count == waiting->count &&
-        (messege->tag == MIMPI_ANY_TAG || waiting->tag == MIMPI_ANY_TAG || messege->tag == waiting->tag)) {
-        return true;
+    while (size > 0) {
+        int iov_cnt = fill_iov(iter, iov, size);
+        struct iovec *current = iov;
+
+        while (iov_cnt > 0) {
+            int result = chsendv(desc, current, iov_cnt);
+
+            if (result == -1 && errno == EAGAIN)
+                return write_packed_rest(desc, current, iov_cnt, iter, size);
+            if (result == -1)
+                return -1;
+
+            size -= result;
+            while (iov_cnt > 0 && (size_t)result >= current->iov_len) {
+                result -= current->iov_len;
+                current++;
+                iov_cnt--;
+            }
+            if (iov_cnt > 0) {
+                current->iov_base += result;
+                current->iov_len -= result;
+            }
+        }
     }
 
-    return false;
+    return 0;
 }
 
-static struct messege_t * find_match(struct meta_data_t *info) {
-    struct messege_t *messege = first_messege;
-    while (messege != NULL) {
-        if (messege_match(&messege->info, info))
-            return messege;
+// ---- BEGIN Implementation of payload compression.
+
+// Data is split into byte planes (every 4th byte), as neighbouring bytes of
+// numbers in one plane are often equal, and each plane is run length encoded.
+// Control byte c < 128 is followed by c + 1 literal bytes, control byte
+// c >= 128 is followed by single byte repeated c - 125 times.
+#define COMPRESS_THRESHOLD_VAR "MIMPI_COMPRESS_THRESHOLD"
+#define COMPRESS_PLANES 4
+#define COMPRESS_MIN_RUN 3
+#define COMPRESS_MAX_RUN 130
+#define COMPRESS_MAX_LITERAL 128
+
+// Sends to process, whose data didn't compress well, are sent uncompressed
+// for a while.
+#define COMPRESS_BACKOFF 64
+
+// compress_threshold - messeges at least that big are compressed (0 - never)
+// compress_backoff   - number of messeges to given process to send uncompressed
+static int compress_threshold;
+static int compress_backoff[N];
+
+// Encodes length bytes src[0], src[stride], ... Returns -1 if result would
+// be longer than limit.
+static int rle_encode(const uint8_t *src, int length, int stride, uint8_t *dst, int limit) {
+    int out = 0;
+    int i = 0;
+
+    while (i < length) {
+        int run = 1;
+        while (i + run < length && run < COMPRESS_MAX_RUN && src[(i + run) * stride] == src[i * stride])
+            run++;
+
+        if (run >= COMPRESS_MIN_RUN) {
+            if (out + 2 > limit)
+                return -1;
+            dst[out++] = run + 125;
+            dst[out++] = src[i * stride];
+            i += run;
+            continue;
+        }
 
-        messege = messege->next_messege;
+        int end = i;
+        while (end < length && end - i < COMPRESS_MAX_LITERAL) {
+            if (end + 2 < length && src[end * stride] == src[(end + 1) * stride] &&
+                src[end * stride] == src[(end + 2) * stride])
+                break;
+            end++;
+        }
+
+        if (out + 1 + end - i > limit)
+            return -1;
+        dst[out++] = end - i - 1;
+        for (; i < end; i++)
+            dst[out++] = src[i * stride];
     }
-    return NULL;
+
+    return out;
 }
 
-static void handle_default_messege(struct messege_t *messege) {
-    ASSERT_ZERO(pthread_mutex_lock(&mutex));
+// Decodes length bytes into dst[0], dst[stride], ... Returns number of bytes read.
+static int rle_decode(const uint8_t *src, int length, int stride, uint8_t *dst) {
+    int in = 0;
+    int i = 0;
 
-    if (messege_match(&messege->info, wait_line) && wanted_messege == NULL) {
-        wanted_messege = messege;
-        ASSERT_ZERO(pthread_mutex_unlock(&wait_line_mutex));
-    } else {
-        add_messege_to_list(messege);
+    while (i < length) {
+        int control = src[in++];
+
+        if (control < 128) {
+            for (int j = 0; j <= control; j++)
+                dst[(i++) * stride] = src[in++];
+        } else {
+            for (int j = 0; j < control - 125; j++)
+                dst[(i++) * stride] = src[in];
+            in++;
+        }
     }
 
-    ASSERT_ZERO(pthread_mutex_unlock(&mutex));
+    return in;
 }
 
-static void handle_PtP_messege(struct messege_t *messege) {
-    handle_default_messege(messege);
+static int compression_planes(int count) {
+    return count % COMPRESS_PLANES == 0 ? COMPRESS_PLANES : 1;
 }
 
-static void handle_Process_ended(struct messege_t *messege) {
-    ASSERT_ZERO(pthread_mutex_lock(&mutex));
-
-    has_ended[messege->info.from] = true;
+// Returns length of compressed data or -1 if it would be longer than limit.
+static int compress_payload(const uint8_t *data, int count, uint8_t *dst, int limit) {
+    int planes = compression_planes(count);
+    int length = 0;
 
-    if (wait_line != NULL && wanted_messege == NULL && (wait_line->from == messege->info.from)) {
+    for (int plane = 0; plane < planes; plane++) {
+        int plane_length = rle_encode(data + plane, count / planes, planes, dst + length, limit - length);
+        if (plane_length == -1)
+            return -1;
+        length += plane_length;
+    }
+
+    return length;
+}
+
+static void decompress_payload(const uint8_t *src, int count, uint8_t *data) {
+    int planes = compression_planes(count);
+
+    for (int plane = 0; plane < planes; plane++)
+        src += rle_decode(src, count / planes, planes, data + plane);
+}
+
+// ---- END Implementation of payload compression.
+
+static void build_header(struct meta_data_t *info, struct meta_data_being_send_t *info2) {
+    info2->messege_type   = info->messege_type;
+    info2->context        = info->context;
+    info2->from           = info->from;
+    info2->count_here     =               min(info->count, META_DATA_MINI_BUFOR_SIZE);
+    info2->count_not_here = info->count - min(info->count, META_DATA_MINI_BUFOR_SIZE);
+    info2->count_uncompressed = -1;
+    info2->tag            = info->tag;
+    info2->deadlock_cnt1  = info->deadlock_cnt1;
+    info2->deadlock_cnt2  = info->deadlock_cnt2;
+}
+
+// Headers sent to every process through its header channel. Messege sent
+// through control channel carries it, so that it isn't handled before
+// messeges sent earlier (see progress_control).
+static atomic_int data_sent[N];
+
+// Messeges of deadlock detection and barriers, which are whole in header,
+// go through control channel, read ahead of other messeges.
+static bool is_control(struct meta_data_being_send_t *info2) {
+    return (info2->messege_type == Deadlock_check || info2->messege_type == Deadlock || info2->messege_type == Barrier)
+        && info2->count_not_here == 0;
+}
+
+static int write_header(int where_to_rank, struct meta_data_being_send_t *info2) {
+    int desc;
+    info2->sender = world_rank;
+
+    if (is_control(info2)) {
+        desc = CTRL_OUT + where_to_rank;
+        info2->lane_seq = atomic_load(&data_sent[where_to_rank]);
+    } else {
+        desc = OUT + where_to_rank * world_size + where_to_rank;
+        info2->lane_seq = atomic_fetch_add(&data_sent[where_to_rank], 1);
+    }
+
+    int send_return = chsend(desc, info2, sizeof(struct meta_data_being_send_t));
+    if (send_return == -1)
+        return -1;
+
+    // Assert atomicity of messege < 512 bytes.
+    ASSERT_ZERO(send_return - sizeof(struct meta_data_being_send_t));
+
+    stats_add(&stats->peers[where_to_rank].sent_messeges, 1);
+    stats_add(&stats->peers[where_to_rank].sent_bytes, info2->count_here + info2->count_not_here);
+    return 0;
+}
+
+// Sends header with already filled mini bufor, followed by rest of data.
+static int write_messege(int where_to_rank, struct meta_data_being_send_t *info2, const void *data) {
+    if (write_header(where_to_rank, info2) == -1)
+        return -1;
+
+    if (info2->count_not_here == 0)
+        return 0;
+
+    bool blocked = stats_block_send(where_to_rank);
+    int result = write_loop(
+            OUT + world_rank * world_size + where_to_rank, 
+            data + info2->count_here,
+            info2->count_not_here
+        );
+    stats_unblock_send(blocked);
+
+    return result;
+}
+
+// Sends messege compressed. Returns 1 if compression didn't pay off and
+// nothing was sent.
+static int send_compressed(int where_to_rank, struct meta_data_being_send_t *info2, const void *data) {
+    int count = info2->count_here + info2->count_not_here;
+    int limit = count - count / 8;
+
+    uint8_t *compressed = malloc(limit);
+    ASSERT_ZERO(compressed == NULL);
+
+    int length = compress_payload(data, count, compressed, limit);
+    if (length == -1) {
+        free(compressed);
+        return 1;
+    }
+
+    // Header of persistent request can't be changed.
+    struct meta_data_being_send_t header = *info2;
+    header.count_uncompressed = count;
+    header.count_here         =          min(length, META_DATA_MINI_BUFOR_SIZE);
+    header.count_not_here     = length - min(length, META_DATA_MINI_BUFOR_SIZE);
+    memcpy(&header.mini_bufor, compressed, header.count_here);
+
+    int result = write_messege(where_to_rank, &header, compressed);
+    free(compressed);
+    return result;
+}
+
+// Sends messege with ready header, compressing it if it is worth it.
+static int send_header(int where_to_rank, struct meta_data_being_send_t *info2, const void *data) {
+    if (compress_threshold > 0 && data != NULL && info2->count_here + info2->count_not_here >= compress_threshold) {
+        if (compress_backoff[where_to_rank] > 0) {
+            compress_backoff[where_to_rank]--;
+        } else {
+            int result = send_compressed(where_to_rank, info2, data);
+            if (result != 1)
+                return result;
+            compress_backoff[where_to_rank] = COMPRESS_BACKOFF;
+        }
+    }
+
+    return write_messege(where_to_rank, info2, data);
+}
+
+// Sends count elements of type, gathering them straight from data.
+static int send_typed_messege(int where_to_rank, struct meta_data_t *info, MIMPI_Datatype type, const void *data, int count) {
+    if (has_ended[where_to_rank])
+        return -1;
+
+    struct meta_data_being_send_t info2;
+    build_header(info, &info2);
+
+    struct type_iter_t iter = type_iter(type, data, count);
+    type_iter_copy(&iter, (uint8_t *)&info2.mini_bufor, info2.count_here, false);
+
+    if (write_header(where_to_rank, &info2) == -1)
+        return -1;
+
+    bool blocked = stats_block_send(where_to_rank);
+    int result = writev_loop(OUT + world_rank * world_size + where_to_rank, &iter, info2.count_not_here);
+    stats_unblock_send(blocked);
+
+    return result;
+}
+
+static int send_messege(int where_to_rank, struct meta_data_t *info, const void *data) {
+    if (has_ended[where_to_rank])
+        return -1;
+
+    struct meta_data_being_send_t info2;
+    build_header(info, &info2);
+
+    if (data != NULL)
+        memcpy(&info2.mini_bufor, data, info2.count_here);
+
+    return send_header(where_to_rank, &info2, data);
+}
+
+static bool messege_match(struct meta_data_t *messege, struct meta_data_t *waiting) {
+    if (messege == NULL || waiting == NULL)
+        return false;
+
+    if (messege->messege_type == waiting->messege_type &&
+        messege->context == waiting->context &&
+        (waiting->from == MIMPI_ANY_SOURCE || messege->from == waiting->from) &&
+        (waiting->count == ANY_COUNT || messege->count == waiting->count ||
+         (waiting->count_is_limit && messege->count <= waiting->count)) &&
+        (messege->tag == MIMPI_ANY_TAG || waiting->tag == MIMPI_ANY_TAG || messege->tag == waiting->tag)) {
+        return true;
+    }
+
+    return false;
+}
+
+static struct messege_t * find_match(struct meta_data_t *info) {
+    struct messege_t *messege = first_messege;
+    while (messege != NULL) {
+        if (messege_match(&messege->info, info))
+            return messege;
+
+        messege = messege->next_messege;
+    }
+    return NULL;
+}
+
+static struct request_t * find_posted_request(struct meta_data_t *info) {
+    struct request_t *request = first_request;
+    while (request != NULL) {
+        if (messege_match(info, &request->info))
+            return request;
+
+        request = request->next_request;
+    }
+    return NULL;
+}
+
+// Marks request as done, messege (without data) is used to wake main program.
+// Requires mutex to be held.
+static void finish_request(struct request_t *request, struct messege_t *messege) {
+    request->completed = true;
+    request->result = MIMPI_SUCCESS;
+    request->received = messege->info;
+
+    if (wait_line == &request->info && wanted_messege == NULL) {
+        wanted_messege = messege;
+        wake_main_thread();
+    } else {
+        free(messege);
+    }
+}
+
+// Takes first posted receive matching incoming messege out of the list.
+static struct request_t * claim_posted_request(struct meta_data_t *info) {
+    ASSERT_ZERO(pthread_mutex_lock(&mutex));
+
+    struct request_t *request = find_posted_request(info);
+    if (request != NULL)
+        remove_request_from_list(request);
+
+    ASSERT_ZERO(pthread_mutex_unlock(&mutex));
+    return request;
+}
+
+static void complete_posted_request(struct request_t *request, struct messege_t *messege) {
+    ASSERT_ZERO(pthread_mutex_lock(&mutex));
+    finish_request(request, messege);
+    ASSERT_ZERO(pthread_mutex_unlock(&mutex));
+}
+
+// Puts contiguous data of messege in place of receive.
+static void put_request_data(struct request_t *request, uint8_t *data, int count) {
+    if (request->type == MIMPI_BYTE) {
+        memcpy(request->data, data, count);
+    } else {
+        struct type_iter_t iter = type_iter(request->type, request->data, request->type_count);
+        type_iter_copy(&iter, data, count, true);
+    }
+}
+
+static void handle_default_messege(struct messege_t *messege) {
+    ASSERT_ZERO(pthread_mutex_lock(&mutex));
+
+    if (messege_match(&messege->info, wait_line) && wanted_messege == NULL) {
+        wanted_messege = messege;
+        wake_main_thread();
+    } else {
+        add_messege_to_list(messege);
+    }
+
+    ASSERT_ZERO(pthread_mutex_unlock(&mutex));
+}
+
+static void handle_PtP_messege(struct messege_t *messege) {
+    ASSERT_ZERO(pthread_mutex_lock(&mutex));
+
+    // Receive could have been posted while data was being read.
+    struct request_t *request = find_posted_request(&messege->info);
+
+    if (request != NULL) {
+        remove_request_from_list(request);
+        put_request_data(request, messege->data, messege->info.count);
+        free(messege->data);
+        messege->data = NULL;
+        finish_request(request, messege);
+    } else {
+        add_messege_to_list(messege);
+
+        // Only probing waits for PtP messege this way, so messege stays in list.
+        if (messege_match(&messege->info, wait_line) && wanted_messege == NULL) {
+            wanted_messege = messege;
+            wake_main_thread();
+        }
+    }
+
+    ASSERT_ZERO(pthread_mutex_unlock(&mutex));
+}
+
+static void handle_Process_ended(struct messege_t *messege) {
+    ASSERT_ZERO(pthread_mutex_lock(&mutex));
+
+    has_ended[messege->info.from] = true;
+
+    if (wait_line != NULL && wanted_messege == NULL &&
+        (wait_line->from == messege->info.from || wait_line->from == MIMPI_ANY_SOURCE)) {
         wanted_messege = messege;
-        ASSERT_ZERO(pthread_mutex_unlock(&wait_line_mutex));
+        wake_main_thread();
     } else {
         free(messege->data);
         free(messege);
@@ -281,6 +1317,7 @@ static void handle_Deadlock_check(struct messege_t *messege) {
         ASSERT_ZERO(deadlock_messege == NULL);
 
         deadlock_messege->info.messege_type  = Deadlock;
+        deadlock_messege->info.context       = 0;
         deadlock_messege->info.from          = world_rank;
         deadlock_messege->info.count         = 0;
         deadlock_messege->info.tag           = 0;
@@ -290,7 +1327,7 @@ static void handle_Deadlock_check(struct messege_t *messege) {
 
         send_messege(wait_line->from, &deadlock_messege->info, NULL);
         wanted_messege = deadlock_messege;
-        ASSERT_ZERO(pthread_mutex_unlock(&wait_line_mutex));
+        wake_main_thread();
     }
 
     free(messege->data);
@@ -304,7 +1341,7 @@ static void handle_Deadlock(struct messege_t *messege) {
 
     if (wait_line != NULL && wanted_messege == NULL && wait_line->deadlock_cnt1 == messege->info.deadlock_cnt1) {
         wanted_messege = messege;
-        ASSERT_ZERO(pthread_mutex_unlock(&wait_line_mutex));
+        wake_main_thread();
     } else {
         free(messege->data);
         free(messege);
@@ -313,547 +1350,3862 @@ static void handle_Deadlock(struct messege_t *messege) {
     ASSERT_ZERO(pthread_mutex_unlock(&mutex));
 }
 
-static void handle_Barrier(struct messege_t *messege) {
+static void progress_nonblocking_collective(int context, int tag);
+
+// Messege of nonblocking collective moves it forward right when it comes.
+static void handle_collective_messege(struct messege_t *messege) {
+    int context = messege->info.context;
+    int tag = messege->info.tag;
+
     handle_default_messege(messege);
+
+    if (context < 0)
+        progress_nonblocking_collective(context, tag);
+}
+
+static void handle_Barrier(struct messege_t *messege) {
+    handle_collective_messege(messege);
 }
 
 static void handle_Bcast(struct messege_t *messege) {
-    handle_default_messege(messege);
+    handle_collective_messege(messege);
 }
 
 static void handle_Reduction(struct messege_t *messege) {
+    handle_collective_messege(messege);
+}
+
+static void handle_Allgather(struct messege_t *messege) {
     handle_default_messege(messege);
 }
 
-static void *messege_handler(void *arg) {
-    while (true) {
+static void handle_Scan(struct messege_t *messege) {
+    handle_default_messege(messege);
+}
 
-        // Part 1 - reading metadata
-        struct messege_t *messege = malloc(sizeof(struct messege_t));
-        ASSERT_ZERO(messege == NULL);
-        struct meta_data_being_send_t info;
-        
-        if (read_loop(IN + world_rank * world_size + world_rank, &info, sizeof(struct meta_data_being_send_t)) == -1) {
-            free(messege);
-            return NULL;
-        }
-
-        messege->info.messege_type  = info.messege_type;
-        messege->info.from          = info.from;
-        messege->info.count         = info.count_here + info.count_not_here;
-        messege->info.tag           = info.tag;
-        messege->info.deadlock_cnt1 = info.deadlock_cnt1;
-        messege->info.deadlock_cnt2 = info.deadlock_cnt2;
-
-        // Part 2 - reading actual data
-        if (messege->info.count > 0) {
-            messege->data = malloc(messege->info.count);
-            ASSERT_ZERO(messege->data == NULL);
-            memcpy(messege->data, &info.mini_bufor, info.count_here);
-
-            if (read_loop(IN + (info.from) * world_size + world_rank, messege->data + info.count_here, info.count_not_here) == -1) {
-                free(messege->data);
-                free(messege);
-                return NULL;
-            }
-        } else {
-            messege->data = NULL;
+static void handle_Large_credit(struct messege_t *messege) {
+    handle_default_messege(messege);
+}
+
+enum progress_result_t {
+    Messege_handled,
+    Other_handled,  // Only control messeges or parts of data came.
+    No_messege,     // Nothing came and we were not to block.
+    Handler_ended,  // Own Process_ended came or channel broke.
+};
+
+// Ended process is noticed by hang up of its data channel to us, as only it
+// holds writing end. Whether hang up of process was already handled is
+// kept in hung_up (used only by reader of messeges).
+static bool hung_up[N];
+
+// Waits up to timeout for header or control channel or data of some messege
+// to become readable or some process to end. Returns whether some channel can
+// be read, otherwise sets ended to rank of ended process or -1.
+static bool wait_for_header(int timeout, int *ended) {
+    struct pollfd poll_desc[2 * N + 2];
+    int ranks[2 * N + 2];
+    bool reading[N] = {false};
+
+    int reading_cnt = receive_poll_descs(poll_desc, ranks);
+    int poll_cnt = reading_cnt;
+
+    for (int i = 2; i < reading_cnt; i++)
+        reading[ranks[i]] = true;
+
+    for (int i = 0; i < world_size; i++) {
+        if (i != world_rank && !hung_up[i] && !reading[i]) {
+            poll_desc[poll_cnt] = (struct pollfd){.fd = IN + i * world_size + world_rank, .events = 0};
+            ranks[poll_cnt++] = i;
         }
+    }
 
-        // Part 3 - handling diffrent operations.
-        switch (messege->info.messege_type) {
-        case PtP_messege:
-            handle_PtP_messege(messege);
-            break;
-        case Process_ended:
-            if (messege->info.from == world_rank) {
-                free(messege->data);
-                free(messege);
-                return NULL;
-            }
-            handle_Process_ended(messege);
-            break;
-        case Deadlock_check:
-            handle_Deadlock_check(messege);
-            break;
-        case Deadlock:
-            handle_Deadlock(messege);
-            break;
-        case Barrier:
-            handle_Barrier(messege);
-            break;
-        case Bcast:
-            handle_Bcast(messege);
-            break;
-        case Reduction:
-            handle_Reduction(messege);
+    *ended = -1;
+    ASSERT_SYS_OK(poll(poll_desc, poll_cnt, timeout));
+
+    // Messeges that ended process sent before hang up are in header and
+    // control channels, so they are handled first.
+    for (int i = 0; i < reading_cnt; i++)
+        if (poll_desc[i].revents != 0)
+            return true;
+
+    for (int i = reading_cnt; i < poll_cnt; i++) {
+        if (poll_desc[i].revents & (POLLHUP | POLLERR)) {
+            hung_up[ranks[i]] = true;
+            *ended = ranks[i];
             break;
         }
     }
-}
 
-void MIMPI_Init(bool enable_deadlock_detection) {
-    channels_init();
+    return false;
+}
 
-    deadlock_detection = enable_deadlock_detection;
-    ASSERT_ZERO(pthread_mutex_init(&mutex, NULL));
-    ASSERT_ZERO(pthread_mutex_init(&wait_line_mutex, NULL));
-    ASSERT_ZERO(pthread_mutex_lock(&wait_line_mutex));
+static enum progress_result_t progress_inbound();
 
-    // Reading env variables.
-    char envvar_name[ENVVAR_LEN];
-    sprintf(envvar_name, "MIMPI_WORLD_SIZE");
-    world_size = string_to_no(getenv(envvar_name));
+// Reads header of next messege. Header channel is nonblocking, so that
+// end of other process can be noticed while waiting.
+static enum progress_result_t read_header(struct meta_data_being_send_t *info, bool block) {
+    int desc = IN + world_rank * world_size + world_rank;
+    int bytes_read = 0;
+    int size = sizeof(struct meta_data_being_send_t);
 
-    sprintf(envvar_name, "MIMPI_%d", getpid());
-    world_rank = string_to_no(getenv(envvar_name));
+    while (bytes_read < size) {
+        int read_result = chrecv(desc, (void *)info + bytes_read, size - bytes_read);
 
-    ASSERT_ZERO(pthread_create(&messege_handler_thread, NULL, messege_handler, NULL));
-}
+        if (read_result == -1 && errno == EAGAIN && bytes_read > 0) {
+            struct pollfd poll_desc = {.fd = desc, .events = POLLIN};
+            ASSERT_SYS_OK(poll(&poll_desc, 1, poll_timeout()));
+            continue;
+        }
 
-void MIMPI_Finalize() {
-    struct meta_data_t info = {
-        .messege_type = Process_ended, 
-        .from = world_rank, 
-        .count = 0, 
-        .tag = 0
-    };
+        if (read_result == -1 && errno == EAGAIN) {
+            int ended;
+            bool ready = wait_for_header(block ? poll_timeout() : 0, &ended);
 
-    send_messege(world_rank, &info, NULL);
+            if (ready) {
+                bool control = progress_control();
+                enum progress_result_t inbound_result = progress_inbound();
 
-    ASSERT_ZERO(pthread_join(messege_handler_thread, NULL));
+                if (inbound_result == Handler_ended)
+                    return Handler_ended;
+                if (control || inbound_result == Messege_handled)
+                    return Other_handled;
+            }
 
-    // Closing opened descriptors (reading ends) to avoid deadlock. 
-    for (int i1 = 0; i1 < world_size; i1++) {
-        for (int i2 = 0; i2 < world_size; i2++) {
-            if (i2 == world_rank) {
-                ASSERT_SYS_OK(close(IN + i1 * world_size + i2));
+            if (ended != -1) {
+                struct meta_data_t ended_info = {
+                    .messege_type = Process_ended, 
+                    .from = ended, 
+                    .count = 0, 
+                    .tag = 0
+                };
+                build_header(&ended_info, info);
+                info->sender = ended;
+                return Messege_handled;
             }
-        }
-    }
 
-    // Sending messege about ending of this process.
-    for (int i = 0; i < world_size; i++) {
-        if (i != world_rank) {
-            send_messege(i, &info, NULL);
+            if (!ready && !block)
+                return No_messege;
+            continue;
         }
+
+        if (read_result == -1 || read_result == 0)
+            return Handler_ended;
+
+        bytes_read += read_result;
     }
 
-    // Closing opened descriptors (writing ends).
-    for (int i1 = 0; i1 < world_size; i1++) {
-        for (int i2 = 0; i2 < world_size; i2++) {
-            if ((i2 != world_rank && i1 == world_rank) || (i1 == i2)) {
-                ASSERT_SYS_OK(close(OUT + i1 * world_size + i2));
-            }
+    return Messege_handled;
+}
+
+static struct messege_t *messege_from_header(struct meta_data_being_send_t *info) {
+    struct messege_t *messege = malloc(sizeof(struct messege_t));
+    ASSERT_ZERO(messege == NULL);
+
+    messege->info.messege_type  = info->messege_type;
+    messege->info.context       = info->context;
+    messege->info.from          = info->from;
+    messege->info.count         = (info->count_uncompressed == -1) ? info->count_here + info->count_not_here
+                                                                   : info->count_uncompressed;
+    messege->info.tag           = info->tag;
+    messege->info.deadlock_cnt1 = info->deadlock_cnt1;
+    messege->info.deadlock_cnt2 = info->deadlock_cnt2;
+    messege->data               = NULL;
+
+    return messege;
+}
+
+// Handles messege with data already read.
+static enum progress_result_t dispatch_messege(struct messege_t *messege) {
+    switch (messege->info.messege_type) {
+    case PtP_messege:
+        handle_PtP_messege(messege);
+        break;
+    case Process_ended:
+        if (messege->info.from == world_rank) {
+            free(messege->data);
+            free(messege);
+            return Handler_ended;
         }
+        handle_Process_ended(messege);
+        break;
+    case Deadlock_check:
+        handle_Deadlock_check(messege);
+        break;
+    case Deadlock:
+        handle_Deadlock(messege);
+        break;
+    case Barrier:
+        handle_Barrier(messege);
+        break;
+    case Bcast:
+        handle_Bcast(messege);
+        break;
+    case Reduction:
+        handle_Reduction(messege);
+        break;
+    case Allgather:
+        handle_Allgather(messege);
+        break;
+    case Scan:
+        handle_Scan(messege);
+        break;
+    case Large_credit:
+        handle_Large_credit(messege);
+        break;
+    case Collective_progress:
+        free_messege(messege);
+        break;
     }
 
-    ASSERT_ZERO(pthread_mutex_unlock(&wait_line_mutex));
-    ASSERT_ZERO(pthread_mutex_destroy(&wait_line_mutex));
-    ASSERT_ZERO(pthread_mutex_destroy(&mutex));
+    return Messege_handled;
+}
 
-    // Cleaning bufor.
-    struct messege_t *next_to_erase = first_messege;
-    while (next_to_erase != NULL) {
-        struct messege_t *current_to_erase = next_to_erase;
-        next_to_erase = current_to_erase->next_messege;
+// ---- BEGIN Implementation of control channel.
+
+// Every process has control channel besides header channel. Control messeges
+// are read before any other messege and also while data of long messege is
+// being read, so deadlock detection and barriers don't wait for bulk data.
+// Answer of deadlock detection must not overtake messeges sent earlier by the
+// same process (they may be the ones we wait for), so control messege waits
+// in deferred_control until lane_seq messeges from its sender were handled.
+// Barrier tokens have no such order and are handled right away.
+
+// data_handled          - messeges handled from header channel, by sender
+// deferred_control      - control messeges waiting for earlier messeges
+static int data_handled[N];
+static struct meta_data_being_send_t *deferred_control = NULL;
+static int deferred_cnt = 0;
+static int deferred_capacity = 0;
+
+static bool control_ordered(struct meta_data_being_send_t *info) {
+    return info->messege_type != Barrier;
+}
 
-        free(current_to_erase->data);
-        free(current_to_erase);
+static void defer_control(struct meta_data_being_send_t *info) {
+    if (deferred_cnt == deferred_capacity) {
+        deferred_capacity = deferred_capacity == 0 ? N : 2 * deferred_capacity;
+        deferred_control = realloc(deferred_control, deferred_capacity * sizeof(struct meta_data_being_send_t));
+        ASSERT_ZERO(deferred_control == NULL);
     }
 
-    channels_finalize();
+    deferred_control[deferred_cnt++] = *info;
 }
 
-int MIMPI_World_size() {
-    return world_size;
+// Notes that messege from sender was handled and handles control messeges,
+// which waited for it.
+static void data_lane_handled(int sender) {
+    data_handled[sender]++;
+
+    int i = 0;
+    while (i < deferred_cnt) {
+        if (deferred_control[i].sender != sender || deferred_control[i].lane_seq > data_handled[sender]) {
+            i++;
+            continue;
+        }
+
+        struct meta_data_being_send_t info = deferred_control[i];
+        deferred_control[i] = deferred_control[--deferred_cnt];
+        dispatch_messege(messege_from_header(&info));
+    }
 }
 
-int MIMPI_World_rank() {
-    return world_rank;
+// Handles all control messeges that already came. Returns whether there was any.
+static bool progress_control() {
+    struct meta_data_being_send_t info;
+    bool handled = false;
+
+    // Control messeges are smaller than 512 bytes, so they are read whole.
+    while (chrecv(CTRL_IN + world_rank, &info, sizeof(info)) == sizeof(info)) {
+        handled = true;
+        stats_add(&stats->peers[info.sender].received_messeges, 1);
+        stats_add(&stats->peers[info.sender].received_bytes, info.count_here);
+
+        if (control_ordered(&info) && info.lane_seq > data_handled[info.sender])
+            defer_control(&info);
+        else
+            dispatch_messege(messege_from_header(&info));
+    }
+
+    return handled;
 }
 
-MIMPI_Retcode MIMPI_Send(
-    void const *data,
-    int count,
-    int destination,
-    int tag
-) {
-    if (destination == world_rank)
-        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+static void control_finalize() {
+    free(deferred_control);
+    deferred_control = NULL;
+    deferred_cnt = 0;
+    deferred_capacity = 0;
+}
 
-    if (destination < 0 || world_size <= destination)
-        return MIMPI_ERROR_NO_SUCH_RANK;
+// ---- END Implementation of control channel.
 
-    struct meta_data_t info = {
-        .messege_type = PtP_messege, 
-        .from         = world_rank, 
-        .count        = count, 
-        .tag          = tag
-    };
+// ---- BEGIN Implementation of receive engine.
 
-    pthread_mutex_lock(&mutex);
-    int has_dest_ended = has_ended[destination];
-    pthread_mutex_unlock(&mutex);
+// Data of messeges from diffrent processes come through diffrent channels, so
+// they are read at the same time, each a bit whenever its channel has some.
+// Long messege from one process doesn't hold up messeges from others.
+// Messeges of single process are handled in order they were sent, so headers
+// that came while data of earlier messege is read wait in queue of sender.
 
-    if (has_dest_ended || send_messege(destination, &info, data) == -1){
-        return MIMPI_ERROR_REMOTE_FINISHED;
+enum inbound_state_t {
+    Inbound_idle,
+    Inbound_reading,    // Data of messege is being read.
+    Inbound_finishing,  // Messege is being handled.
+};
+
+struct inbound_t {
+    enum inbound_state_t state;
+    struct meta_data_being_send_t info;
+    struct messege_t *messege;
+    struct request_t *request;  // Posted receive taking data (or NULL).
+    uint8_t *place;             // Where next data goes, if not scattered.
+    uint8_t *compressed;        // Bufor for compressed data (or NULL).
+    int left;
+
+    // Data scattered straight to receive with datatype.
+    bool scattered;
+    struct type_iter_t iter;
+    struct iovec iov[IOV_BATCH];
+    int iov_first;
+    int iov_cnt;
+
+    struct meta_data_being_send_t *queue;
+    int queue_first;
+    int queue_cnt;
+    int queue_capacity;
+};
+
+static struct inbound_t inbound[N];
+
+// Descriptors to wait on for reading messeges: header and control channels
+// and data channels of messeges being read. Ranks of those are put in ranks.
+static int receive_poll_descs(struct pollfd *poll_desc, int *ranks) {
+    int poll_cnt = 2;
+
+    poll_desc[0] = (struct pollfd){.fd = IN + world_rank * world_size + world_rank, .events = POLLIN};
+    poll_desc[1] = (struct pollfd){.fd = CTRL_IN + world_rank, .events = POLLIN};
+    ranks[0] = ranks[1] = -1;
+
+    for (int i = 0; i < world_size; i++) {
+        if (inbound[i].state == Inbound_reading) {
+            poll_desc[poll_cnt] = (struct pollfd){.fd = IN + i * world_size + world_rank, .events = POLLIN};
+            ranks[poll_cnt++] = i;
+        }
     }
 
-    return MIMPI_SUCCESS;
+    return poll_cnt;
 }
 
-MIMPI_Retcode MIMPI_Recv(
-    void *data,
-    int count,
-    int source,
-    int tag
-) {
-    if (source == world_rank)
-        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+static enum progress_result_t finish_inbound(int sender) {
+    struct inbound_t *in = &inbound[sender];
+    struct messege_t *messege = in->messege;
+    struct request_t *request = in->request;
+    in->state = Inbound_finishing;
 
-    if (source < 0 || world_size <= source)
-        return MIMPI_ERROR_NO_SUCH_RANK;
+    if (in->compressed != NULL) {
+        int count = messege->info.count;
 
-    deadlock_detection_messege_cnt++;
-    struct meta_data_t info = {
-        .messege_type  = PtP_messege, 
-        .from          = source, 
-        .count         = count, 
-        .tag           = tag, 
-        .deadlock_cnt1 = deadlock_detection_messege_cnt
-    };
+        // Compressed data has to be decompressed before scattering.
+        if (request != NULL && request->type != MIMPI_BYTE) {
+            uint8_t *bufor = malloc(count);
+            ASSERT_ZERO(count > 0 && bufor == NULL);
 
-    pthread_mutex_lock(&mutex);
+            decompress_payload(in->compressed, count, bufor);
+            put_request_data(request, bufor, count);
+            free(bufor);
+        } else {
+            decompress_payload(in->compressed, count, request != NULL ? request->data : messege->data);
+        }
 
-    // Check if answer to request can be determined now.
-    struct messege_t *ans = find_match(&info);
-    if (ans != NULL) {
-        memcpy(data, ans->data, count);
-        remove_messege_from_list(ans);
-        pthread_mutex_unlock(&mutex);
-        return MIMPI_SUCCESS;
-    } else if (has_ended[source]) {
-        pthread_mutex_unlock(&mutex);
-        return MIMPI_ERROR_REMOTE_FINISHED;
+        free(in->compressed);
+        in->compressed = NULL;
     }
 
-    if (deadlock_detection) {
-        struct meta_data_t d_info = {
-            .messege_type  = Deadlock_check, 
-            .from          = world_rank, 
-            .count         = 0, 
-            .tag           = tag, 
-            .deadlock_cnt1 = deadlock_detection_messege_cnt
-        };
+    // Process_ended of other process is made up after hang up, not sent.
+    bool sent = in->info.messege_type != Process_ended;
 
-        send_messege(source, &d_info, NULL);
+    // Counted before messege is handed over, so that receiver already sees it.
+    if (sent) {
+        stats_add(&stats->peers[sender].received_messeges, 1);
+        stats_add(&stats->peers[sender].received_bytes, in->info.count_here + in->info.count_not_here);
     }
 
-    // Wait until answer can be determined.
-    wait_line = &info;
-    wanted_messege = NULL;
+    enum progress_result_t result = Messege_handled;
+    if (request != NULL)
+        complete_posted_request(request, messege);
+    else
+        result = dispatch_messege(messege);
 
-    pthread_mutex_unlock(&mutex);
+    if (result == Messege_handled && sent)
+        data_lane_handled(sender);
 
-    pthread_mutex_lock(&wait_line_mutex);
-    pthread_mutex_lock(&mutex);
+    in->state = Inbound_idle;
+    return result;
+}
 
-    MIMPI_Retcode return_code;
+// Prepares place for data of messege and takes what came in header.
+static enum progress_result_t start_inbound(struct meta_data_being_send_t *info) {
+    struct inbound_t *in = &inbound[info->sender];
 
-    if (wanted_messege->info.messege_type == PtP_messege) {
-        memcpy(data, wanted_messege->data, count);
-        return_code = MIMPI_SUCCESS;
-    } else if (wanted_messege->info.messege_type == Process_ended) {
-        return_code = MIMPI_ERROR_REMOTE_FINISHED;
-    } else if (wanted_messege->info.messege_type == Deadlock) {
-        return_code = MIMPI_ERROR_DEADLOCK_DETECTED;
-    }
+    in->info = *info;
+    in->messege = messege_from_header(info);
+    in->request = NULL;
+    in->left = info->count_not_here;
+    in->scattered = false;
 
-    free(wanted_messege->data);
-    free(wanted_messege);
+    struct messege_t *messege = in->messege;
+    if (messege->info.messege_type == PtP_messege)
+        in->request = claim_posted_request(&messege->info);
 
-    wanted_messege = NULL;
-    wait_line = NULL;
+    if (in->request == NULL && messege->info.count > 0) {
+        messege->data = malloc(messege->info.count);
+        ASSERT_ZERO(messege->data == NULL);
+    }
 
-    pthread_mutex_unlock(&mutex);
+    if (info->count_uncompressed != -1) {
+        in->compressed = malloc(info->count_here + info->count_not_here);
+        ASSERT_ZERO(in->compressed == NULL);
+        memcpy(in->compressed, &info->mini_bufor, info->count_here);
+        in->place = in->compressed + info->count_here;
+    } else if (in->request != NULL && in->request->type != MIMPI_BYTE) {
+        // Receive was posted earlier, so data goes straight to user's bufor.
+        in->scattered = true;
+        in->iter = type_iter(in->request->type, in->request->data, in->request->type_count);
+        in->iov_cnt = 0;
+        type_iter_copy(&in->iter, (uint8_t *)&info->mini_bufor, info->count_here, true);
+    } else {
+        uint8_t *data = in->request != NULL ? in->request->data : messege->data;
+        if (info->count_here > 0)
+            memcpy(data, &info->mini_bufor, info->count_here);
+        in->place = data + info->count_here;
+    }
 
-    return return_code;
+    if (in->left == 0)
+        return finish_inbound(info->sender);
+
+    in->state = Inbound_reading;
+    return Messege_handled;
 }
 
-MIMPI_Retcode MIMPI_Barrier() {
-    for (int level = 0; pow2[level] < world_size; level++) {
+// Starts messeges waiting in queue of sender, until one has data to read.
+static enum progress_result_t next_inbound(int sender) {
+    struct inbound_t *in = &inbound[sender];
 
-        // Sending messege forward.
-        int where_to = (world_size + world_rank - pow2[level]) % world_size;
+    while (in->state == Inbound_idle && in->queue_cnt > 0) {
+        struct meta_data_being_send_t info = in->queue[in->queue_first];
+        in->queue_first++;
+        in->queue_cnt--;
 
-        struct meta_data_t info_to_send = {
-            .messege_type = Barrier, 
-            .from         = world_rank, 
-            .count        = 0, 
-            .tag          = 0,
-        };
+        if (start_inbound(&info) == Handler_ended)
+            return Handler_ended;
+    }
 
-        send_messege(where_to, &info_to_send, NULL);
+    if (in->queue_cnt == 0)
+        in->queue_first = 0;
 
-        // Waiting for messege from back.
-        pthread_mutex_lock(&mutex);
+    return Messege_handled;
+}
 
-        int where_from = (world_rank + pow2[level]) % world_size;
+static enum progress_result_t receive_header(struct meta_data_being_send_t *info) {
+    struct inbound_t *in = &inbound[info->sender];
 
-        struct meta_data_t info_to_recv = {
-            .messege_type = Barrier, 
-            .from         = where_from, 
-            .count        = 0, 
-            .tag          = 0,
-        };
+    // Messeges that came while this one was handled wait in queue.
+    if (in->state == Inbound_idle && in->queue_cnt == 0) {
+        if (start_inbound(info) == Handler_ended)
+            return Handler_ended;
+        return next_inbound(info->sender);
+    }
 
-        struct messege_t *ans = find_match(&info_to_recv);
+    if (in->queue_first + in->queue_cnt == in->queue_capacity) {
+        in->queue_capacity = in->queue_capacity == 0 ? N : 2 * in->queue_capacity;
+        in->queue = realloc(in->queue, in->queue_capacity * sizeof(struct meta_data_being_send_t));
+        ASSERT_ZERO(in->queue == NULL);
+    }
 
-        if (ans != NULL) {
-            remove_messege_from_list(ans);
-            pthread_mutex_unlock(&mutex);
-        } else {
-            if (has_ended[where_from]) {
-                pthread_mutex_unlock(&mutex);
-                return MIMPI_ERROR_REMOTE_FINISHED;
-            }
+    in->queue[in->queue_first + in->queue_cnt++] = *info;
+    return Messege_handled;
+}
 
-            wait_line = &info_to_recv;
-            wanted_messege = NULL;
-            pthread_mutex_unlock(&mutex);
+// Reads once whatever came of every messege being read.
+static enum progress_result_t progress_inbound() {
+    bool progressed = false;
 
-            pthread_mutex_lock(&wait_line_mutex);
-            pthread_mutex_lock(&mutex);
+    for (int i = 0; i < world_size; i++) {
+        struct inbound_t *in = &inbound[i];
+        if (in->state != Inbound_reading)
+            continue;
 
-            if (wanted_messege->info.messege_type == Process_ended) {
-                free(wanted_messege->data);
-                free(wanted_messege);
+        int desc = IN + i * world_size + world_rank;
+        int read_result;
 
-                wait_line = NULL;
-                wanted_messege = NULL;
-                
-                pthread_mutex_unlock(&mutex);
-                return MIMPI_ERROR_REMOTE_FINISHED;
+        if (in->scattered) {
+            if (in->iov_cnt == 0) {
+                in->iov_first = 0;
+                in->iov_cnt = fill_iov(&in->iter, in->iov, in->left);
             }
+            read_result = chrecvv(desc, in->iov + in->iov_first, in->iov_cnt);
+        } else {
+            read_result = chrecv(desc, in->place, in->left);
+        }
 
-            free(wanted_messege->data);
-            free(wanted_messege);
-
-            wait_line = NULL;
-            wanted_messege = NULL;
+        if (read_result == -1 && errno == EAGAIN)
+            continue;
 
-            pthread_mutex_unlock(&mutex);
+        // Channel broke in the middle of messege.
+        if (read_result == -1 || read_result == 0)
+            return Handler_ended;
+
+        progressed = true;
+        in->left -= read_result;
+
+        if (in->scattered) {
+            struct iovec *current = in->iov + in->iov_first;
+            while (in->iov_cnt > 0 && (size_t)read_result >= current->iov_len) {
+                read_result -= current->iov_len;
+                current++;
+                in->iov_first++;
+                in->iov_cnt--;
+            }
+            if (in->iov_cnt > 0) {
+                current->iov_base += read_result;
+                current->iov_len -= read_result;
+            }
+        } else {
+            in->place += read_result;
         }
+
+        if (in->left == 0 && (finish_inbound(i) == Handler_ended || next_inbound(i) == Handler_ended))
+            return Handler_ended;
     }
 
-    return MIMPI_SUCCESS;
+    return progressed ? Messege_handled : No_messege;
 }
 
-int get_level_of_getting_data_Bcast(int rank, int root) {
-    return lowest_used_bit((world_size + root - rank) % world_size);
+static void inbound_finalize() {
+    for (int i = 0; i < world_size; i++) {
+        free(inbound[i].queue);
+        inbound[i].queue = NULL;
+        inbound[i].queue_first = inbound[i].queue_cnt = inbound[i].queue_capacity = 0;
+    }
 }
 
-MIMPI_Retcode MIMPI_Bcast(
-    void *data,
-    int count,
-    int root
-) {
-    void *data_cpy = malloc(count);
-    ASSERT_ZERO(data_cpy == NULL);
+// ---- END Implementation of receive engine.
+
+// Reads and handles single messege, or part of its data.
+static enum progress_result_t progress_one_messege(bool block) {
+    // Control messeges go ahead of others.
+    if (progress_control())
+        return Messege_handled;
+
+    enum progress_result_t inbound_result = progress_inbound();
+    if (inbound_result == Handler_ended)
+        return Handler_ended;
+
+    // Header channel is looked at even if some data was read, as otherwise
+    // long messege, whose data keeps coming, would hold up all others.
+    struct meta_data_being_send_t info;
+    enum progress_result_t header_result = read_header(&info, block && inbound_result == No_messege);
+    if (header_result == Other_handled)
+        return Messege_handled;
+    if (header_result == No_messege)
+        return inbound_result;
+    if (header_result != Messege_handled)
+        return header_result;
+
+    return receive_header(&info);
+}
 
-    if (world_rank == root)
-        memcpy(data_cpy, data, count);
+// Handles all messeges that already came, in polling modes.
+static void progress_pending() {
+    if (progress_mode != MIMPI_PROGRESS_THREAD)
+        while (progress_one_messege(false) == Messege_handled);
+}
 
-    int level_of_getting_data = get_level_of_getting_data_Bcast(world_rank, root);
+static void *messege_handler(void *arg) {
+    while (progress_one_messege(true) == Messege_handled);
+    return NULL;
+}
 
-    for (int level = highest_pow2(world_size); level >= 0; level--) {
-        // Sending messege forward.
-        int where_to = (world_size + world_rank - pow2[level]) % world_size;
-        struct meta_data_t info_to_send = {
-            .messege_type = Bcast, 
-            .from         = world_rank, 
-            .count        = (level == get_level_of_getting_data_Bcast(where_to, root)) ? count : 0, 
-            .tag          = 0, 
-        };
+// ---- BEGIN Implementation of shared memory collectives.
 
-        send_messege(where_to, &info_to_send, data_cpy);
+// Barrier, Bcast and Reduce over MIMPI_COMM_WORLD go through memory shared
+// by all processes instead of channels. Every process counts steps it has done
+// in shm->progress, and steps are numbered the same way in all processes,
+// so waiting for other process means waiting for its counter.
 
-        // Reading messege from back.
-        int where_from = (world_rank + pow2[level]) % world_size;
-        struct meta_data_t info_to_recv = {
-            .messege_type = Bcast, 
-            .from         = where_from, 
-            .count        = (level == level_of_getting_data) ? count : 0, 
-            .tag          = 0, 
-        };
+// shm       - memory created by mimpirun (NULL if there is none)
+// shm_steps - steps done by this process
+// shm_sense - sense of last barrier of this process
+static struct shm_t *shm = NULL;
+static int shm_steps = 0;
+static int shm_sense = 0;
 
-        pthread_mutex_lock(&mutex);
+static void perform_operation(uint8_t *data, uint8_t *new_data, int length, MIMPI_Op op);
 
-        struct messege_t *ans = find_match(&info_to_recv);
+static bool shm_usable(MIMPI_Comm comm) {
+    return shm != NULL && comm == MIMPI_COMM_WORLD && !hierarchical && !deadlock_detection;
+}
 
-        if (ans != NULL) {
-            if (level == level_of_getting_data)
-                memcpy(data_cpy, ans->data, count);
+static void shm_init() {
+    // Programs not started by mimpirun have no shared memory.
+    if (fcntl(SHM_DESC, F_GETFD) == -1)
+        return;
 
-            remove_messege_from_list(ans);
+    shm = mmap(NULL, sizeof(struct shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, SHM_DESC, 0);
+    ASSERT_ZERO(shm == MAP_FAILED);
+    ASSERT_SYS_OK(close(SHM_DESC));
+}
 
-            pthread_mutex_unlock(&mutex);
-        } else {
-            if (has_ended[where_from]){
-                pthread_mutex_unlock(&mutex);
-                free(data_cpy);
-                return MIMPI_ERROR_REMOTE_FINISHED;
-            }
+static void shm_finalize() {
+    if (shm == NULL)
+        return;
 
-            wait_line = &info_to_recv;
-            wanted_messege = NULL;
-            pthread_mutex_unlock(&mutex);
+    // Wakes everybody waiting for this process, so that they notice its end.
+    atomic_fetch_or(&shm->progress[world_rank].value, 1);
+    futex_wake(&shm->progress[world_rank].value, INT_MAX);
+    atomic_fetch_add(&shm->barrier_sense, 2);
+    futex_wake(&shm->barrier_sense, INT_MAX);
 
-            pthread_mutex_lock(&wait_line_mutex);
-            pthread_mutex_lock(&mutex);
+    ASSERT_SYS_OK(munmap(shm, sizeof(struct shm_t)));
+    shm = NULL;
+}
 
-            if (wanted_messege->info.messege_type == Process_ended) {
-                free(wanted_messege->data);
-                free(wanted_messege);
-                pthread_mutex_unlock(&mutex);
-                free(data_cpy);
-                return MIMPI_ERROR_REMOTE_FINISHED;
-            }
+static void shm_publish(int steps) {
+    struct shm_counter_t *counter = &shm->progress[world_rank];
 
-            if (level == level_of_getting_data)
-                memcpy(data_cpy, wanted_messege->data, count);
+    shm_steps = steps;
+    atomic_store(&counter->value, steps << 1);
+    if (atomic_load(&counter->sleepers) > 0)
+        futex_wake(&counter->value, INT_MAX);
+}
 
-            free(wanted_messege->data);
-            free(wanted_messege);
+// Called in i-th iteration of waiting for word to change from value.
+// Spins for a while, then sleeps.
+static void shm_pause(atomic_int *word, int value, atomic_int *sleepers, int i) {
+    if (i < spin_budget)
+        return;
+
+    // In polling modes messeges must be read meanwhile, as someone might
+    // be waiting for space in our channel.
+    if (progress_mode != MIMPI_PROGRESS_THREAD) {
+        progress_pending();
+        sched_yield();
+        return;
+    }
 
-            wait_line = NULL;
-            wanted_messege = NULL;
+    atomic_fetch_add(sleepers, 1);
+    if (atomic_load(word) == value)
+        futex_wait(word, value);
+    atomic_fetch_sub(sleepers, 1);
+}
 
-            pthread_mutex_unlock(&mutex);
+// Waits until process has done given number of steps.
+static MIMPI_Retcode shm_wait(int rank, int steps) {
+    struct shm_counter_t *counter = &shm->progress[rank];
+    MIMPI_Retcode return_code = MIMPI_SUCCESS;
+    stats_block(Stats_shm_wait, rank);
+
+    for (int i = 0; ; i++) {
+        int value = atomic_load_explicit(&counter->value, memory_order_acquire);
+        if ((value >> 1) >= steps)
+            break;
+        if (value & 1) {
+            return_code = MIMPI_ERROR_REMOTE_FINISHED;
+            break;
         }
+
+        shm_pause(&counter->value, value, &counter->sleepers, i);
     }
 
-    if (world_rank != root)
-        memcpy(data, data_cpy, count);
+    stats_block(Stats_none, -1);
+    return return_code;
+}
+
+static MIMPI_Retcode shm_wait_all(int steps) {
+    for (int i = 0; i < world_size; i++) {
+        if (i == world_rank)
+            continue;
+
+        MIMPI_Retcode return_code = shm_wait(i, steps);
+        if (return_code != MIMPI_SUCCESS)
+            return return_code;
+    }
 
-    free(data_cpy);
     return MIMPI_SUCCESS;
 }
 
-void perform_operation(uint8_t *data, uint8_t *new_data, int length, MIMPI_Op op) {
-    for (int i = 0; i < length; i++) {
-        switch(op) {
-        case(MIMPI_MAX):
-            if (new_data[i] > data[i])
-                data[i] = new_data[i];
-            break;
-        case(MIMPI_MIN):
-            if (new_data[i] < data[i])
-                data[i] = new_data[i];
-            break;
-        case(MIMPI_SUM):
-            data[i] += new_data[i];
-            break;
-        case(MIMPI_PROD):
-            data[i] *= new_data[i];
-            break;
+static bool shm_anyone_ended() {
+    for (int i = 0; i < world_size; i++)
+        if (i != world_rank && (atomic_load(&shm->progress[i].value) & 1))
+            return true;
+    return false;
+}
+
+// Sense reversing barrier: last process to come resets counter and flips
+// sense, for which others wait.
+static MIMPI_Retcode shm_barrier_wait() {
+    // Ended process will never come, and coming would break next barriers.
+    if (shm_anyone_ended())
+        return MIMPI_ERROR_REMOTE_FINISHED;
+
+    shm_sense ^= 1;
+    if (atomic_fetch_add(&shm->barrier_count, 1) == world_size - 1) {
+        atomic_store(&shm->barrier_count, 0);
+        atomic_fetch_xor(&shm->barrier_sense, 1);
+        if (atomic_load(&shm->barrier_sleepers) > 0)
+            futex_wake(&shm->barrier_sense, INT_MAX);
+        return MIMPI_SUCCESS;
+    }
+
+    for (int i = 0; ; i++) {
+        int value = atomic_load_explicit(&shm->barrier_sense, memory_order_acquire);
+        if ((value & 1) == shm_sense)
+            return MIMPI_SUCCESS;
+
+        if (shm_anyone_ended()) {
+            // Ended process might have come last and flipped sense before ending.
+            if ((atomic_load(&shm->barrier_sense) & 1) == shm_sense)
+                return MIMPI_SUCCESS;
+            return MIMPI_ERROR_REMOTE_FINISHED;
         }
+
+        shm_pause(&shm->barrier_sense, value, &shm->barrier_sleepers, i);
     }
 }
 
-int get_sending_level_Reduce(int rank, int root) {
-    if (root == rank)
-        return -1;
-    return lowest_used_bit((world_size - root + rank) % world_size);
+static MIMPI_Retcode shm_barrier() {
+    stats_block(Stats_shm_barrier, -1);
+    MIMPI_Retcode return_code = shm_barrier_wait();
+    stats_block(Stats_none, -1);
+    return return_code;
 }
 
-MIMPI_Retcode MIMPI_Reduce(
+// Root copies every chunk once into one of two bufors, from which everyone
+// copies it. Bufor can be overwritten after everyone read chunk before last.
+// At the end everyone waits for all to read last chunk, so that Bcast is
+// synchronisation point as the one through channels.
+static MIMPI_Retcode shm_bcast(void *data, int count, int root) {
+    int chunks = max(1, (count + SHM_CHUNK - 1) / SHM_CHUNK);
+
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        int step = shm_steps;
+        int offset = chunk * SHM_CHUNK;
+        int length = min(SHM_CHUNK, count - offset);
+        uint8_t *bufor = shm->bcast[step % 2];
+        MIMPI_Retcode return_code;
+
+        if (world_rank == root) {
+            return_code = shm_wait_all(step - 1);
+            if (return_code != MIMPI_SUCCESS)
+                return return_code;
+            memcpy(bufor, (uint8_t *)data + offset, length);
+        } else {
+            return_code = shm_wait(root, step + 1);
+            if (return_code != MIMPI_SUCCESS)
+                return return_code;
+            memcpy((uint8_t *)data + offset, bufor, length);
+        }
+
+        shm_publish(step + 1);
+    }
+
+    return shm_wait_all(shm_steps);
+}
+
+// Every chunk takes three steps: everyone copies its data into own bufor,
+// then reduces own slice of all bufors into result and at last root copies
+// result. Slices are reduced in rank order, so any operation can be used.
+static MIMPI_Retcode shm_reduce(
     void const *send_data,
     void *recv_data,
     int count,
     MIMPI_Op op,
     int root
 ) {
-    uint8_t *data_cpy = malloc(count);
-    ASSERT_ZERO(data_cpy == NULL);
-    int array_length = count;
-    memcpy(data_cpy, send_data, count);
+    int element_size = op_element_size(op);
+    int chunk_size = SHM_CHUNK / element_size * element_size;
+    int chunks = max(1, (count + chunk_size - 1) / chunk_size);
+    uint8_t const *own_data = (send_data == MIMPI_IN_PLACE) ? recv_data : send_data;
+
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        int step = shm_steps;
+        int offset = chunk * chunk_size;
+        int length = min(chunk_size, count - offset);
+
+        // Part 1 - own data; previous chunk was reduced by everyone.
+        MIMPI_Retcode return_code = shm_wait_all(step - 1);
+        if (return_code != MIMPI_SUCCESS)
+            return return_code;
+        memcpy(shm->contrib[world_rank], own_data + offset, length);
+        shm_publish(step + 1);
+
+        // Part 2 - own slice; root has already copied previous result.
+        return_code = shm_wait_all(step + 1);
+        if (return_code != MIMPI_SUCCESS)
+            return return_code;
+
+        int elements = length / element_size;
+        int slice_begin = elements * world_rank / world_size * element_size;
+        int slice_end = elements * (world_rank + 1) / world_size * element_size;
+        if (slice_begin < slice_end) {
+            memcpy(shm->result + slice_begin, shm->contrib[0] + slice_begin, slice_end - slice_begin);
+            for (int i = 1; i < world_size; i++)
+                perform_operation(shm->result + slice_begin, shm->contrib[i] + slice_begin, slice_end - slice_begin, op);
+        }
+        shm_publish(step + 2);
+
+        // Part 3 - result.
+        if (world_rank == root) {
+            return_code = shm_wait_all(step + 2);
+            if (return_code != MIMPI_SUCCESS)
+                return return_code;
+            memcpy((uint8_t *)recv_data + offset, shm->result, length);
+        }
+        shm_publish(step + 3);
+    }
 
-    int level_of_sending_data = get_sending_level_Reduce(world_rank, root);
+    return MIMPI_SUCCESS;
+}
 
-    for (int level = 0; level <= highest_pow2(world_size); level++) {
-        bool will_send_data = (level == level_of_sending_data);
-        // Sending messege forward.
-        int where_to = (world_size + world_rank - pow2[level]) % world_size;
-        struct meta_data_t info_to_send = {
-            .messege_type = Reduction, 
-            .from         = world_rank, 
-            .count        = will_send_data ? count : 0, 
-            .tag          = op + 1, 
-        };
+// ---- END Implementation of shared memory collectives.
 
-        send_messege(where_to, &info_to_send, data_cpy);
+void MIMPI_Init(bool enable_deadlock_detection) {
+    MIMPI_Init_progress(enable_deadlock_detection, MIMPI_PROGRESS_THREAD);
+}
 
-        // Reading messege from back.
-        int where_from = (world_rank + pow2[level]) % world_size;
-        bool will_receive_data = (get_sending_level_Reduce(where_from, root) == level);
-        struct meta_data_t info_to_recv = {
-            .messege_type = Reduction, 
-            .from = where_from, 
-            .count = will_receive_data ? count : 0, 
-            .tag = op + 1, 
-        };
+void MIMPI_Init_progress(bool enable_deadlock_detection, MIMPI_Progress progress) {
+    channels_init();
 
-        pthread_mutex_lock(&mutex);
+    deadlock_detection = enable_deadlock_detection;
+    progress_mode = progress;
+    ASSERT_ZERO(pthread_mutex_init(&mutex, NULL));
 
-        struct messege_t *ans = find_match(&info_to_recv);
+    // Reading env variables.
+    char envvar_name[ENVVAR_LEN];
+    sprintf(envvar_name, "MIMPI_WORLD_SIZE");
+    world_size = string_to_no(getenv(envvar_name));
 
-        if (ans != NULL) {
-            if (will_receive_data)
-                perform_operation(data_cpy, ans->data, array_length, op);
+    sprintf(envvar_name, "MIMPI_%d", getpid());
+    world_rank = string_to_no(getenv(envvar_name));
 
-            remove_messege_from_list(ans);
+    world_comm.context = 0;
+    world_comm.rank = world_rank;
+    world_comm.size = world_size;
+    world_comm.world_ranks = malloc(world_size * sizeof(int));
+    ASSERT_ZERO(world_comm.world_ranks == NULL);
+    for (int i = 0; i < world_size; i++)
+        world_comm.world_ranks[i] = i;
 
-            pthread_mutex_unlock(&mutex);
-        } else {
-            if (has_ended[where_from]) {
-                pthread_mutex_unlock(&mutex);
-                free(data_cpy);
-                return MIMPI_ERROR_REMOTE_FINISHED;
-            }
+    setup_groups();
+    shm_init();
+    stats_init();
 
-            wait_line = &info_to_recv;
-            wanted_messege = NULL;
-            pthread_mutex_unlock(&mutex);
+    char *spin_budget_str = getenv(SPIN_BUDGET_VAR);
+    spin_budget = spin_budget_str == NULL ? DEFAULT_SPIN_BUDGET : string_to_no(spin_budget_str);
 
-            pthread_mutex_lock(&wait_line_mutex);
-            pthread_mutex_lock(&mutex);
+    char *compress_threshold_str = getenv(COMPRESS_THRESHOLD_VAR);
+    compress_threshold = compress_threshold_str == NULL ? 0 : string_to_no(compress_threshold_str);
 
-            if (wanted_messege->info.messege_type == Process_ended) {
-                free(wanted_messege->data);
-                free(wanted_messege);
-                pthread_mutex_unlock(&mutex);
-                free(data_cpy);
-                return MIMPI_ERROR_REMOTE_FINISHED;
-            }
+    char *reduce_segment_str = getenv(REDUCE_SEGMENT_VAR);
+    reduce_segment_size = reduce_segment_str == NULL ? DEFAULT_REDUCE_SEGMENT : string_to_no(reduce_segment_str);
+    if (reduce_segment_size <= 0)
+        reduce_segment_size = DEFAULT_REDUCE_SEGMENT;
+
+    // Channels read by this process are read only by it, so they can be
+    // made nonblocking (see read_header and progress_inbound). In polling modes
+    // data channels we write to are used only by this process too.
+    for (int i = 0; i < world_size; i++) {
+        int descs[2] = {IN + i * world_size + world_rank, OUT + world_rank * world_size + i};
+        int descs_cnt = (i == world_rank || progress_mode == MIMPI_PROGRESS_THREAD) ? 1 : 2;
 
-            if (will_receive_data)
-                perform_operation(data_cpy, wanted_messege->data, array_length, op);
+        for (int j = 0; j < descs_cnt; j++) {
+            int flags;
+            ASSERT_SYS_OK(flags = fcntl(descs[j], F_GETFL));
+            ASSERT_SYS_OK(fcntl(descs[j], F_SETFL, flags | O_NONBLOCK));
+        }
+    }
 
-            free(wanted_messege->data);
-            free(wanted_messege);
+    int control_flags;
+    ASSERT_SYS_OK(control_flags = fcntl(CTRL_IN + world_rank, F_GETFL));
+    ASSERT_SYS_OK(fcntl(CTRL_IN + world_rank, F_SETFL, control_flags | O_NONBLOCK));
 
-            wait_line = NULL;
-            wanted_messege = NULL;
+    if (progress_mode == MIMPI_PROGRESS_THREAD)
+        ASSERT_ZERO(pthread_create(&messege_handler_thread, NULL, messege_handler, NULL));
+}
 
-            pthread_mutex_unlock(&mutex);
-        }
+void MIMPI_Finalize() {
+    struct meta_data_t info = {
+        .messege_type = Process_ended, 
+        .from = world_rank, 
+        .count = 0, 
+        .tag = 0
+    };
+
+    if (progress_mode == MIMPI_PROGRESS_THREAD) {
+        send_messege(world_rank, &info, NULL);
+        ASSERT_ZERO(pthread_join(messege_handler_thread, NULL));
     }
-    
-    if (world_rank == root)
-        memcpy(recv_data, data_cpy, count);
 
-    free(data_cpy);
-    return MIMPI_SUCCESS;
-}
\ No newline at end of file
+    // Closing opened descriptors (reading ends), so that nobody waits
+    // for space in our channels.
+    for (int i = 0; i < world_size; i++)
+        ASSERT_SYS_OK(close(IN + i * world_size + world_rank));
+    ASSERT_SYS_OK(close(CTRL_IN + world_rank));
+
+    shm_finalize();
+    stats_finalize();
+
+    // Closing opened descriptors (writing ends). Others learn about our end
+    // from hang up of our data channels, so no messeges are sent.
+    for (int i = 0; i < world_size; i++) {
+        if (i != world_rank)
+            ASSERT_SYS_OK(close(OUT + world_rank * world_size + i));
+        ASSERT_SYS_OK(close(OUT + i * world_size + i));
+        ASSERT_SYS_OK(close(CTRL_OUT + i));
+    }
+
+    ASSERT_ZERO(pthread_mutex_destroy(&mutex));
+
+    // Cleaning bufor.
+    struct messege_t *next_to_erase = first_messege;
+    while (next_to_erase != NULL) {
+        struct messege_t *current_to_erase = next_to_erase;
+        next_to_erase = current_to_erase->next_messege;
+
+        free(current_to_erase->data);
+        free(current_to_erase);
+    }
+
+    free(world_comm.world_ranks);
+    if (hierarchical) {
+        free(group_comm.world_ranks);
+        free(leaders_comm.world_ranks);
+    }
+    free(user_ops);
+    control_finalize();
+    inbound_finalize();
+
+    channels_finalize();
+}
+
+int MIMPI_World_size() {
+    return world_size;
+}
+
+int MIMPI_World_rank() {
+    return world_rank;
+}
+
+MIMPI_Retcode MIMPI_Send(
+    void const *data,
+    int count,
+    int destination,
+    int tag
+) {
+    return MIMPI_Send_comm(data, count, destination, tag, MIMPI_COMM_WORLD);
+}
+
+MIMPI_Retcode MIMPI_Send_comm(
+    void const *data,
+    int count,
+    int destination,
+    int tag,
+    MIMPI_Comm comm
+) {
+    if (destination == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    if (destination < 0 || comm->size <= destination)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    destination = comm->world_ranks[destination];
+
+    struct meta_data_t info = {
+        .messege_type = PtP_messege, 
+        .context      = comm->context,
+        .from         = world_rank, 
+        .count        = count, 
+        .tag          = tag
+    };
+
+    pthread_mutex_lock(&mutex);
+    int has_dest_ended = has_ended[destination];
+    pthread_mutex_unlock(&mutex);
+
+    if (has_dest_ended || send_messege(destination, &info, data) == -1){
+        return MIMPI_ERROR_REMOTE_FINISHED;
+    }
+
+    return MIMPI_SUCCESS;
+}
+
+// Whether messege from source can't come anymore. Requires mutex to be held.
+static bool source_ended(MIMPI_Comm comm, int source) {
+    if (source != MIMPI_ANY_SOURCE)
+        return has_ended[source];
+
+    for (int i = 0; i < comm->size; i++)
+        if (comm->world_ranks[i] != world_rank && !has_ended[comm->world_ranks[i]])
+            return false;
+
+    return true;
+}
+
+// Sends deadlock check to source of awaited messege. Requires mutex to be held.
+static void start_deadlock_check(struct meta_data_t *info) {
+    deadlock_detection_messege_cnt++;
+    info->deadlock_cnt1 = deadlock_detection_messege_cnt;
+
+    // Waiting for any source is never reported as deadlock.
+    if (deadlock_detection && info->from != MIMPI_ANY_SOURCE) {
+        struct meta_data_t d_info = {
+            .messege_type  = Deadlock_check, 
+            .from          = world_rank, 
+            .count         = 0, 
+            .tag           = info->tag, 
+            .deadlock_cnt1 = deadlock_detection_messege_cnt
+        };
+
+        send_messege(info->from, &d_info, NULL);
+    }
+}
+
+static enum stats_call_t stats_call_of(enum messege_type_t type) {
+    switch (type) {
+    case PtP_messege:
+        return Stats_recv;
+    case Barrier:
+        return Stats_barrier;
+    case Bcast:
+        return Stats_bcast;
+    case Reduction:
+        return Stats_reduce;
+    case Allgather:
+        return Stats_allgather;
+    case Scan:
+        return Stats_scan;
+    case Large_credit:
+        return Stats_large_credit;
+    default:
+        return Stats_collective;
+    }
+}
+
+// Sleeps until handler finds answer for info. Requires mutex to be held.
+static struct messege_t * wait_for_wanted_messege(struct meta_data_t *info) {
+    wait_line = info;
+    wanted_messege = NULL;
+
+    stats_block(stats_call_of(info->messege_type), info->from);
+    long long wait_start = stats_now();
+
+    if (progress_mode == MIMPI_PROGRESS_THREAD) {
+        atomic_store(&wake_state, Not_woken);
+        pthread_mutex_unlock(&mutex);
+
+        wait_for_wake();
+        pthread_mutex_lock(&mutex);
+    } else {
+        // There is no handler thread - we read messeges ourselves.
+        while (wanted_messege == NULL) {
+            pthread_mutex_unlock(&mutex);
+            ASSERT_ZERO(progress_one_messege(true) == Handler_ended);
+            pthread_mutex_lock(&mutex);
+        }
+    }
+
+    stats_add(&stats->blocked_ns, stats_now() - wait_start);
+    stats_block(Stats_none, -1);
+
+    struct messege_t *ans = wanted_messege;
+    wanted_messege = NULL;
+    wait_line = NULL;
+
+    return ans;
+}
+
+// Translates world rank of messege sender to rank in comm.
+static int comm_rank_of(MIMPI_Comm comm, int world) {
+    for (int i = 0; i < comm->size; i++)
+        if (comm->world_ranks[i] == world)
+            return i;
+    return MIMPI_UNDEFINED;
+}
+
+static void fill_status(MIMPI_Comm comm, struct meta_data_t *messege, MIMPI_Status *status) {
+    status->source = comm_rank_of(comm, messege->from);
+    status->tag = messege->tag;
+    status->count = messege->count;
+}
+
+static void init_recv_request(
+    struct request_t *request,
+    void *data,
+    int count,
+    int source,
+    int tag,
+    MIMPI_Comm comm
+) {
+    if (source != MIMPI_ANY_SOURCE)
+        source = comm->world_ranks[source];
+
+    struct meta_data_t info = {
+        .messege_type  = PtP_messege, 
+        .context       = comm->context,
+        .from          = source, 
+        .count         = count, 
+        .tag           = tag
+    };
+
+    request->kind      = Recv_request;
+    request->comm      = comm;
+    request->peer      = source;
+    request->data      = data;
+    request->type      = MIMPI_BYTE;
+    request->type_count = count;
+    request->active    = false;
+    request->posted    = false;
+    request->completed = false;
+    request->result    = MIMPI_SUCCESS;
+    request->info      = info;
+}
+
+static void start_recv_request(struct request_t *request) {
+    request->active = true;
+    request->completed = false;
+
+    pthread_mutex_lock(&mutex);
+
+    // Check if answer to request can be determined now.
+    struct messege_t *ans = find_match(&request->info);
+    if (ans != NULL) {
+        put_request_data(request, ans->data, ans->info.count);
+        request->received = ans->info;
+        remove_messege_from_list(ans);
+        request->completed = true;
+        request->result = MIMPI_SUCCESS;
+    } else {
+        add_request_to_list(request);
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+static MIMPI_Retcode wait_recv_request(struct request_t *request) {
+    pthread_mutex_lock(&mutex);
+
+    while (!request->completed) {
+        if (request->posted && source_ended(request->comm, request->peer)) {
+            remove_request_from_list(request);
+            request->completed = true;
+            request->result = MIMPI_ERROR_REMOTE_FINISHED;
+            break;
+        }
+
+        start_deadlock_check(&request->info);
+        struct messege_t *ans = wait_for_wanted_messege(&request->info);
+
+        // PtP_messege means that handler already put data in place,
+        // after Process_ended we check again whether source can still send.
+        if (ans->info.messege_type == Deadlock) {
+            if (request->posted)
+                remove_request_from_list(request);
+
+            request->completed = true;
+            request->result = MIMPI_ERROR_DEADLOCK_DETECTED;
+        }
+
+        free_messege(ans);
+    }
+
+    request->active = false;
+    pthread_mutex_unlock(&mutex);
+
+    return request->result;
+}
+
+// Takes posted receive back. If handler has already taken it, its data is
+// on the way, so it is waited for.
+static void cancel_recv_request(struct request_t *request) {
+    pthread_mutex_lock(&mutex);
+
+    if (request->posted) {
+        remove_request_from_list(request);
+        request->completed = true;
+        request->active = false;
+    }
+    bool taken = !request->completed;
+
+    pthread_mutex_unlock(&mutex);
+
+    if (taken)
+        wait_recv_request(request);
+}
+
+MIMPI_Retcode MIMPI_Recv(
+    void *data,
+    int count,
+    int source,
+    int tag
+) {
+    return MIMPI_Recv_comm(data, count, source, tag, MIMPI_COMM_WORLD);
+}
+
+MIMPI_Retcode MIMPI_Recv_comm(
+    void *data,
+    int count,
+    int source,
+    int tag,
+    MIMPI_Comm comm
+) {
+    if (source == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    if (source != MIMPI_ANY_SOURCE && (source < 0 || comm->size <= source))
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    struct request_t request;
+    init_recv_request(&request, data, count, source, tag, comm);
+    start_recv_request(&request);
+
+    return wait_recv_request(&request);
+}
+
+MIMPI_Retcode MIMPI_Recv_status(
+    void *data,
+    int capacity,
+    int source,
+    int tag,
+    MIMPI_Comm comm,
+    MIMPI_Status *status
+) {
+    if (source == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    if (source != MIMPI_ANY_SOURCE && (source < 0 || comm->size <= source))
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    struct request_t request;
+    init_recv_request(&request, data, capacity, source, tag, comm);
+    request.info.count_is_limit = true;
+    start_recv_request(&request);
+
+    MIMPI_Retcode return_code = wait_recv_request(&request);
+
+    if (return_code == MIMPI_SUCCESS && status != NULL)
+        fill_status(comm, &request.received, status);
+
+    return return_code;
+}
+
+MIMPI_Retcode MIMPI_Send_type(
+    void const *data,
+    int count,
+    MIMPI_Datatype type,
+    int destination,
+    int tag,
+    MIMPI_Comm comm
+) {
+    if (type_contiguous(type))
+        return MIMPI_Send_comm(data, count * MIMPI_Type_size(type), destination, tag, comm);
+
+    if (destination == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    if (destination < 0 || comm->size <= destination)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    destination = comm->world_ranks[destination];
+
+    struct meta_data_t info = {
+        .messege_type = PtP_messege, 
+        .context      = comm->context,
+        .from         = world_rank, 
+        .count        = count * MIMPI_Type_size(type), 
+        .tag          = tag
+    };
+
+    pthread_mutex_lock(&mutex);
+    int has_dest_ended = has_ended[destination];
+    pthread_mutex_unlock(&mutex);
+
+    if (has_dest_ended || send_typed_messege(destination, &info, type, data, count) == -1)
+        return MIMPI_ERROR_REMOTE_FINISHED;
+
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Recv_type(
+    void *data,
+    int count,
+    MIMPI_Datatype type,
+    int source,
+    int tag,
+    MIMPI_Comm comm
+) {
+    if (source == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    if (source != MIMPI_ANY_SOURCE && (source < 0 || comm->size <= source))
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    struct request_t request;
+    init_recv_request(&request, data, count * MIMPI_Type_size(type), source, tag, comm);
+    if (!type_contiguous(type)) {
+        request.type = type;
+        request.type_count = count;
+    }
+    start_recv_request(&request);
+
+    return wait_recv_request(&request);
+}
+
+MIMPI_Retcode MIMPI_Sendrecv(
+    void const *send_data,
+    int send_count,
+    int destination,
+    int send_tag,
+    void *recv_data,
+    int recv_capacity,
+    int source,
+    int recv_tag,
+    MIMPI_Comm comm,
+    MIMPI_Status *status
+) {
+    if (source == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    if (source != MIMPI_ANY_SOURCE && (source < 0 || comm->size <= source))
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    // Destination is checked before receive is posted, as failing send
+    // should not wait for messege that may never come.
+    if (destination == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    if (destination < 0 || comm->size <= destination)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    pthread_mutex_lock(&mutex);
+    int has_dest_ended = has_ended[comm->world_ranks[destination]];
+    pthread_mutex_unlock(&mutex);
+
+    if (has_dest_ended)
+        return MIMPI_ERROR_REMOTE_FINISHED;
+
+    // Receive is posted first, so incoming data lands straight in recv_data
+    // while we are still sending.
+    struct request_t request;
+    init_recv_request(&request, recv_data, recv_capacity, source, recv_tag, comm);
+    request.info.count_is_limit = true;
+    start_recv_request(&request);
+
+    MIMPI_Retcode send_code = MIMPI_Send_comm(send_data, send_count, destination, send_tag, comm);
+    if (send_code != MIMPI_SUCCESS) {
+        cancel_recv_request(&request);
+        return send_code;
+    }
+
+    MIMPI_Retcode recv_code = wait_recv_request(&request);
+
+    if (recv_code == MIMPI_SUCCESS && status != NULL)
+        fill_status(comm, &request.received, status);
+
+    return recv_code;
+}
+
+MIMPI_Retcode MIMPI_Sendrecv_replace(
+    void *data,
+    int count,
+    int destination,
+    int send_tag,
+    int source,
+    int recv_tag,
+    MIMPI_Comm comm,
+    MIMPI_Status *status
+) {
+    if (source == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    if (source != MIMPI_ANY_SOURCE && (source < 0 || comm->size <= source))
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    // Data can't be received into bufor that is being sent, so incoming
+    // messege waits in messeges list until send ends.
+    MIMPI_Retcode send_code = MIMPI_Send_comm(data, count, destination, send_tag, comm);
+    if (send_code != MIMPI_SUCCESS)
+        return send_code;
+
+    return MIMPI_Recv_status(data, count, source, recv_tag, comm, status);
+}
+
+MIMPI_Retcode MIMPI_Send_init(
+    void const *data,
+    int count,
+    int destination,
+    int tag,
+    MIMPI_Comm comm,
+    MIMPI_Request *request
+) {
+    if (destination == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    if (destination < 0 || comm->size <= destination)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    destination = comm->world_ranks[destination];
+
+    struct meta_data_t info = {
+        .messege_type = PtP_messege, 
+        .context      = comm->context,
+        .from         = world_rank, 
+        .count        = count, 
+        .tag          = tag
+    };
+
+    struct request_t *new_request = malloc(sizeof(struct request_t));
+    ASSERT_ZERO(new_request == NULL);
+
+    new_request->kind      = Send_request;
+    new_request->comm      = comm;
+    new_request->peer      = destination;
+    new_request->data      = (void *)data;
+    new_request->active    = false;
+    new_request->posted    = false;
+    new_request->completed = false;
+    new_request->result    = MIMPI_SUCCESS;
+    new_request->info      = info;
+    build_header(&info, &new_request->header);
+
+    *request = new_request;
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Recv_init(
+    void *data,
+    int count,
+    int source,
+    int tag,
+    MIMPI_Comm comm,
+    MIMPI_Request *request
+) {
+    if (source == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    if (source != MIMPI_ANY_SOURCE && (source < 0 || comm->size <= source))
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    struct request_t *new_request = malloc(sizeof(struct request_t));
+    ASSERT_ZERO(new_request == NULL);
+
+    init_recv_request(new_request, data, count, source, tag, comm);
+
+    *request = new_request;
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Start(MIMPI_Request request) {
+    if (request->kind == Recv_request) {
+        start_recv_request(request);
+        return MIMPI_SUCCESS;
+    }
+
+    // Header is ready, only mini bufor has to be refreshed.
+    request->active = true;
+    request->completed = true;
+    request->result = MIMPI_SUCCESS;
+
+    memcpy(&request->header.mini_bufor, request->data, request->header.count_here);
+
+    pthread_mutex_lock(&mutex);
+    int has_dest_ended = has_ended[request->peer];
+    pthread_mutex_unlock(&mutex);
+
+    if (has_dest_ended || send_header(request->peer, &request->header, request->data) == -1)
+        request->result = MIMPI_ERROR_REMOTE_FINISHED;
+
+    return request->result;
+}
+
+static MIMPI_Retcode wait_collective(struct request_t *request);
+static void test_collective(struct request_t *request);
+
+MIMPI_Retcode MIMPI_Wait(MIMPI_Request request) {
+    if (!request->active)
+        return request->result;
+
+    if (request->kind == Recv_request)
+        return wait_recv_request(request);
+
+    if (request->kind == Collective_request)
+        return wait_collective(request);
+
+    request->active = false;
+    return request->result;
+}
+
+MIMPI_Retcode MIMPI_Test(MIMPI_Request request, bool *flag) {
+    if (request->kind == Collective_request)
+        test_collective(request);
+    else
+        progress_pending();
+
+    pthread_mutex_lock(&mutex);
+    *flag = request->completed || !request->active;
+    if (request->completed)
+        request->active = false;
+    pthread_mutex_unlock(&mutex);
+
+    return *flag ? request->result : MIMPI_SUCCESS;
+}
+
+static void remove_collective_from_list(struct request_t *request);
+
+void MIMPI_Request_free(MIMPI_Request *request) {
+    if (*request == NULL)
+        return;
+
+    pthread_mutex_lock(&mutex);
+    if ((*request)->posted)
+        remove_request_from_list(*request);
+    if ((*request)->kind == Collective_request && !(*request)->completed)
+        remove_collective_from_list(*request);
+    pthread_mutex_unlock(&mutex);
+
+    if ((*request)->kind == Collective_request && (*request)->coll.own_data)
+        free((*request)->coll.data);
+    free(*request);
+    *request = NULL;
+}
+
+// Waits for messege matching info, which is then taken out of messeges list.
+// Fails if sender has ended before sending it.
+static MIMPI_Retcode receive_messege(struct meta_data_t *info, struct messege_t **result) {
+    pthread_mutex_lock(&mutex);
+
+    struct messege_t *ans = find_match(info);
+
+    if (ans != NULL) {
+        take_messege_from_list(ans);
+    } else {
+        if (has_ended[info->from]) {
+            pthread_mutex_unlock(&mutex);
+            return MIMPI_ERROR_REMOTE_FINISHED;
+        }
+
+        ans = wait_for_wanted_messege(info);
+
+        if (ans->info.messege_type == Process_ended) {
+            free_messege(ans);
+            pthread_mutex_unlock(&mutex);
+            return MIMPI_ERROR_REMOTE_FINISHED;
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    *result = ans;
+    return MIMPI_SUCCESS;
+}
+
+static MIMPI_Retcode probe(
+    int source,
+    int tag,
+    MIMPI_Comm comm,
+    bool blocking,
+    bool *flag,
+    MIMPI_Status *status
+) {
+    if (source == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    if (source != MIMPI_ANY_SOURCE && (source < 0 || comm->size <= source))
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    struct meta_data_t info = {
+        .messege_type  = PtP_messege, 
+        .context       = comm->context,
+        .from          = (source == MIMPI_ANY_SOURCE) ? MIMPI_ANY_SOURCE : comm->world_ranks[source], 
+        .count         = ANY_COUNT, 
+        .tag           = tag
+    };
+
+    MIMPI_Retcode return_code = MIMPI_SUCCESS;
+
+    progress_pending();
+    pthread_mutex_lock(&mutex);
+
+    struct messege_t *ans;
+    while ((ans = find_match(&info)) == NULL && blocking) {
+        if (source_ended(comm, info.from)) {
+            return_code = MIMPI_ERROR_REMOTE_FINISHED;
+            break;
+        }
+
+        start_deadlock_check(&info);
+        struct messege_t *woken = wait_for_wanted_messege(&info);
+
+        // Matching PtP_messege is left in list by handler, so it is found again.
+        if (woken->info.messege_type == PtP_messege) {
+            continue;
+        } else if (woken->info.messege_type == Deadlock) {
+            free_messege(woken);
+            return_code = MIMPI_ERROR_DEADLOCK_DETECTED;
+            break;
+        } else {
+            free_messege(woken);
+        }
+    }
+
+    if (ans != NULL && status != NULL)
+        fill_status(comm, &ans->info, status);
+
+    if (flag != NULL)
+        *flag = (ans != NULL);
+
+    pthread_mutex_unlock(&mutex);
+
+    return return_code;
+}
+
+MIMPI_Retcode MIMPI_Probe(
+    int source,
+    int tag,
+    MIMPI_Comm comm,
+    MIMPI_Status *status
+) {
+    return probe(source, tag, comm, true, NULL, status);
+}
+
+MIMPI_Retcode MIMPI_Iprobe(
+    int source,
+    int tag,
+    MIMPI_Comm comm,
+    bool *flag,
+    MIMPI_Status *status
+) {
+    return probe(source, tag, comm, false, flag, status);
+}
+
+// ---- BEGIN Implementation of large messeges.
+
+// Large messeges are sent in chunks. Receiver posts receive of a chunk and
+// only then gives sender credit for it, so every chunk goes straight to its
+// place and no chunk is ever buffered. Receiver keeps LARGE_WINDOW chunks
+// posted, so that next chunk is being sent while previous one is read.
+#define LARGE_CHUNK (16 * 1024 * 1024)
+#define LARGE_WINDOW 2
+
+static size_t large_chunks(size_t count) {
+    return (count == 0) ? 1 : (count + LARGE_CHUNK - 1) / LARGE_CHUNK;
+}
+
+static int large_chunk_length(size_t count, size_t chunk) {
+    size_t left = count - chunk * LARGE_CHUNK;
+    return (left < LARGE_CHUNK) ? (int)left : LARGE_CHUNK;
+}
+
+MIMPI_Retcode MIMPI_Send_large(
+    void const *data,
+    size_t count,
+    int destination,
+    int tag,
+    MIMPI_Comm comm
+) {
+    if (destination == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    if (destination < 0 || comm->size <= destination)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    struct meta_data_t credit_info = {
+        .messege_type = Large_credit, 
+        .context      = comm->context,
+        .from         = comm->world_ranks[destination], 
+        .count        = 0, 
+        .tag          = tag
+    };
+
+    for (size_t chunk = 0; chunk < large_chunks(count); chunk++) {
+        struct messege_t *credit;
+        MIMPI_Retcode return_code = receive_messege(&credit_info, &credit);
+        if (return_code != MIMPI_SUCCESS)
+            return return_code;
+        free_messege(credit);
+
+        return_code = MIMPI_Send_comm(
+            (uint8_t const *)data + chunk * LARGE_CHUNK,
+            large_chunk_length(count, chunk),
+            destination,
+            tag,
+            comm
+        );
+        if (return_code != MIMPI_SUCCESS)
+            return return_code;
+    }
+
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Recv_large(
+    void *data,
+    size_t count,
+    int source,
+    int tag,
+    MIMPI_Comm comm
+) {
+    if (source == comm->rank)
+        return MIMPI_ERROR_ATTEMPTED_SELF_OP;
+
+    // Credits need known sender.
+    if (source < 0 || comm->size <= source)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    struct meta_data_t credit_info = {
+        .messege_type = Large_credit, 
+        .context      = comm->context,
+        .from         = world_rank, 
+        .count        = 0, 
+        .tag          = tag
+    };
+
+    struct request_t requests[LARGE_WINDOW];
+    size_t chunks = large_chunks(count);
+    size_t posted = 0;
+    MIMPI_Retcode return_code = MIMPI_SUCCESS;
+
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        while (return_code == MIMPI_SUCCESS && posted < chunks && posted < chunk + LARGE_WINDOW) {
+            struct request_t *request = &requests[posted % LARGE_WINDOW];
+            init_recv_request(
+                request,
+                (uint8_t *)data + posted * LARGE_CHUNK,
+                large_chunk_length(count, posted),
+                source,
+                tag,
+                comm
+            );
+            start_recv_request(request);
+            posted++;
+
+            if (send_messege(comm->world_ranks[source], &credit_info, NULL) == -1)
+                return_code = MIMPI_ERROR_REMOTE_FINISHED;
+        }
+
+        // Posted chunks are always waited for, as handler may be writing them.
+        if (chunk < posted) {
+            MIMPI_Retcode chunk_code = wait_recv_request(&requests[chunk % LARGE_WINDOW]);
+            if (return_code == MIMPI_SUCCESS)
+                return_code = chunk_code;
+        }
+    }
+
+    return return_code;
+}
+
+// ---- END Implementation of large messeges.
+
+MIMPI_Retcode MIMPI_Barrier() {
+    return MIMPI_Barrier_comm(MIMPI_COMM_WORLD);
+}
+
+// Barrier within groups, then among leaders, then within groups again,
+// so that no one leaves before all groups came.
+static MIMPI_Retcode hierarchical_barrier() {
+    MIMPI_Retcode return_code = MIMPI_Barrier_comm(&group_comm);
+    if (return_code != MIMPI_SUCCESS)
+        return return_code;
+
+    if (leaders_comm.rank != MIMPI_UNDEFINED) {
+        return_code = MIMPI_Barrier_comm(&leaders_comm);
+        if (return_code != MIMPI_SUCCESS)
+            return return_code;
+    }
+
+    return MIMPI_Barrier_comm(&group_comm);
+}
+
+MIMPI_Retcode MIMPI_Barrier_comm(MIMPI_Comm comm) {
+    if (comm == MIMPI_COMM_WORLD && hierarchical)
+        return hierarchical_barrier();
+
+    if (shm_usable(comm))
+        return shm_barrier();
+
+    for (int level = 0; pow2[level] < comm->size; level++) {
+
+        // Sending messege forward.
+        int where_to = (comm->size + comm->rank - pow2[level]) % comm->size;
+
+        struct meta_data_t info_to_send = {
+            .messege_type = Barrier, 
+            .context      = comm->context,
+            .from         = world_rank, 
+            .count        = 0, 
+            .tag          = 0,
+        };
+
+        send_messege(comm->world_ranks[where_to], &info_to_send, NULL);
+
+        // Waiting for messege from back.
+        int where_from = (comm->rank + pow2[level]) % comm->size;
+
+        struct meta_data_t info_to_recv = {
+            .messege_type = Barrier, 
+            .context      = comm->context,
+            .from         = comm->world_ranks[where_from], 
+            .count        = 0, 
+            .tag          = 0,
+        };
+
+        struct messege_t *ans;
+        MIMPI_Retcode return_code = receive_messege(&info_to_recv, &ans);
+        if (return_code != MIMPI_SUCCESS)
+            return return_code;
+
+        free_messege(ans);
+    }
+
+    return MIMPI_SUCCESS;
+}
+
+static int get_level_of_getting_data_Bcast(int rank, int root, int size) {
+    return lowest_used_bit((size + root - rank) % size);
+}
+
+// Root's group gets data first, then leaders of other groups, then their groups.
+static MIMPI_Retcode hierarchical_bcast(void *data, int count, int root) {
+    bool in_root_group = (group_of[world_rank] == group_of[root]);
+    MIMPI_Retcode return_code;
+
+    if (in_root_group) {
+        return_code = MIMPI_Bcast_comm(data, count, comm_rank_of(&group_comm, root), &group_comm);
+        if (return_code != MIMPI_SUCCESS)
+            return return_code;
+    }
+
+    if (leaders_comm.rank != MIMPI_UNDEFINED) {
+        return_code = MIMPI_Bcast_comm(data, count, leader_of_group(group_of[root]), &leaders_comm);
+        if (return_code != MIMPI_SUCCESS)
+            return return_code;
+    }
+
+    if (!in_root_group)
+        return MIMPI_Bcast_comm(data, count, 0, &group_comm);
+
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Bcast(
+    void *data,
+    int count,
+    int root
+) {
+    return MIMPI_Bcast_comm(data, count, root, MIMPI_COMM_WORLD);
+}
+
+MIMPI_Retcode MIMPI_Bcast_comm(
+    void *data,
+    int count,
+    int root,
+    MIMPI_Comm comm
+) {
+    if (root < 0 || comm->size <= root)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    if (comm == MIMPI_COMM_WORLD && hierarchical)
+        return hierarchical_bcast(data, count, root);
+
+    if (shm_usable(comm))
+        return shm_bcast(data, count, root);
+
+    // Data is sent only after it was received, so user's bufor is used directly.
+    int level_of_getting_data = get_level_of_getting_data_Bcast(comm->rank, root, comm->size);
+
+    for (int level = highest_pow2(comm->size); level >= 0; level--) {
+        // Sending messege forward.
+        int where_to = (comm->size + comm->rank - pow2[level]) % comm->size;
+        struct meta_data_t info_to_send = {
+            .messege_type = Bcast, 
+            .context      = comm->context,
+            .from         = world_rank, 
+            .count        = (level == get_level_of_getting_data_Bcast(where_to, root, comm->size)) ? count : 0, 
+            .tag          = 0, 
+        };
+
+        send_messege(comm->world_ranks[where_to], &info_to_send, data);
+
+        // Reading messege from back.
+        int where_from = (comm->rank + pow2[level]) % comm->size;
+        struct meta_data_t info_to_recv = {
+            .messege_type = Bcast, 
+            .context      = comm->context,
+            .from         = comm->world_ranks[where_from], 
+            .count        = (level == level_of_getting_data) ? count : 0, 
+            .tag          = 0, 
+        };
+
+        struct messege_t *ans;
+        MIMPI_Retcode return_code = receive_messege(&info_to_recv, &ans);
+        if (return_code != MIMPI_SUCCESS)
+            return return_code;
+
+        if (level == level_of_getting_data)
+            memcpy(data, ans->data, count);
+
+        free_messege(ans);
+    }
+
+    return MIMPI_SUCCESS;
+}
+
+// Computes data = data op new_data. Data of lower ranks is in data.
+static void perform_operation(uint8_t *data, uint8_t *new_data, int length, MIMPI_Op op) {
+    if (op >= USER_OP_BASE) {
+        struct user_op_t *user = user_op(op);
+        user->function(data, new_data, length / user->element_size);
+        return;
+    }
+
+    for (int i = 0; i < length; i++) {
+        switch(op) {
+        case(MIMPI_MAX):
+            if (new_data[i] > data[i])
+                data[i] = new_data[i];
+            break;
+        case(MIMPI_MIN):
+            if (new_data[i] < data[i])
+                data[i] = new_data[i];
+            break;
+        case(MIMPI_SUM):
+            data[i] += new_data[i];
+            break;
+        case(MIMPI_PROD):
+            data[i] *= new_data[i];
+            break;
+        }
+    }
+}
+
+static int get_sending_level_Reduce(int rank, int root, int size) {
+    if (root == rank)
+        return -1;
+    return lowest_used_bit((size - root + rank) % size);
+}
+
+// Groups reduce to their leaders, leaders reduce to leader of root's group,
+// which passes result to root.
+static MIMPI_Retcode hierarchical_reduce(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op,
+    int root
+) {
+    bool leader = (leaders_comm.rank != MIMPI_UNDEFINED);
+
+    uint8_t *partial = NULL;
+    bool own_partial = false;
+    if (send_data == MIMPI_IN_PLACE || world_rank == root) {
+        partial = recv_data;
+    } else if (leader) {
+        partial = malloc(count);
+        ASSERT_ZERO(partial == NULL);
+        own_partial = true;
+    }
+
+    MIMPI_Retcode return_code = MIMPI_Reduce_comm(send_data, partial, count, op, 0, &group_comm);
+
+    if (return_code == MIMPI_SUCCESS && leader)
+        return_code = MIMPI_Reduce_comm(MIMPI_IN_PLACE, partial, count, op, leader_of_group(group_of[root]), &leaders_comm);
+
+    int root_leader = group_comm.world_ranks[0];
+    if (return_code == MIMPI_SUCCESS && group_of[world_rank] == group_of[root] && root != root_leader && count > 0) {
+        struct meta_data_t info = {
+            .messege_type = Reduction, 
+            .context      = group_comm.context,
+            .from         = root_leader, 
+            .count        = count, 
+            .tag          = op + 1, 
+        };
+
+        if (world_rank == root_leader) {
+            info.from = world_rank;
+            send_messege(root, &info, partial);
+        } else if (world_rank == root) {
+            struct messege_t *ans;
+            return_code = receive_messege(&info, &ans);
+            if (return_code == MIMPI_SUCCESS) {
+                memcpy(recv_data, ans->data, count);
+                free_messege(ans);
+            }
+        }
+    }
+
+    if (own_partial)
+        free(partial);
+    return return_code;
+}
+
+MIMPI_Retcode MIMPI_Bcast_type(
+    void *data,
+    int count,
+    MIMPI_Datatype type,
+    int root,
+    MIMPI_Comm comm
+) {
+    int size = count * MIMPI_Type_size(type);
+    if (type_contiguous(type))
+        return MIMPI_Bcast_comm(data, size, root, comm);
+
+    // Broadcast passes data through many processes, so it is packed once.
+    uint8_t *bufor = malloc(size);
+    ASSERT_ZERO(size > 0 && bufor == NULL);
+
+    struct type_iter_t iter = type_iter(type, data, count);
+    if (comm->rank == root)
+        type_iter_copy(&iter, bufor, size, false);
+
+    MIMPI_Retcode return_code = MIMPI_Bcast_comm(bufor, size, root, comm);
+
+    if (return_code == MIMPI_SUCCESS && comm->rank != root)
+        type_iter_copy(&iter, bufor, size, true);
+
+    free(bufor);
+    return return_code;
+}
+
+MIMPI_Retcode MIMPI_Reduce(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op,
+    int root
+) {
+    return MIMPI_Reduce_comm(send_data, recv_data, count, op, root, MIMPI_COMM_WORLD);
+}
+
+MIMPI_Retcode MIMPI_Reduce_comm(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op,
+    int root,
+    MIMPI_Comm comm
+) {
+    if (root < 0 || comm->size <= root)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    // Groups don't keep rank order, so non commutative operations can't use them.
+    if (comm == MIMPI_COMM_WORLD && hierarchical && op_commutative(op))
+        return hierarchical_reduce(send_data, recv_data, count, op, root);
+
+    if (shm_usable(comm) && op_element_size(op) <= SHM_CHUNK)
+        return shm_reduce(send_data, recv_data, count, op, root);
+
+    // Tree for non commutative operations is rooted in 0, because then
+    // children hold data of ranks following the ranks of parent.
+    int tree_root = op_commutative(op) ? root : 0;
+
+    int level_of_sending_data = get_sending_level_Reduce(comm->rank, tree_root, comm->size);
+    int parent = (comm->size + comm->rank - pow2[max(level_of_sending_data, 0)]) % comm->size;
+
+    // Partial results are kept in data_cpy. Leaves only send their data,
+    // so they don't need a copy, and in place reduction works in recv_data.
+    bool own_bufor = (send_data != MIMPI_IN_PLACE && level_of_sending_data != 0);
+    uint8_t *data_cpy;
+    if (send_data == MIMPI_IN_PLACE) {
+        data_cpy = recv_data;
+    } else if (!own_bufor) {
+        data_cpy = (uint8_t *)send_data;
+    } else {
+        data_cpy = malloc(count);
+        ASSERT_ZERO(data_cpy == NULL);
+        memcpy(data_cpy, send_data, count);
+    }
+
+    int segment_size = max(reduce_segment_size / op_element_size(op), 1) * op_element_size(op);
+
+    // Part 1 - pipeline. Each segment is reduced with segments of all
+    // children and sent up, before next segment is handled.
+    for (int offset = 0; offset < count; offset += segment_size) {
+        int segment_length = min(segment_size, count - offset);
+
+        bool waiting_for_child[8];
+        int children_left = 0;
+        for (int level = 0; level <= highest_pow2(comm->size); level++) {
+            int where_from = (comm->rank + pow2[level]) % comm->size;
+            waiting_for_child[level] = (get_sending_level_Reduce(where_from, tree_root, comm->size) == level);
+            if (waiting_for_child[level])
+                children_left++;
+        }
+
+        while (children_left > 0) {
+            struct meta_data_t info_to_recv = {
+                .messege_type = Reduction, 
+                .context      = comm->context,
+                .count        = segment_length, 
+                .tag          = op + 1, 
+            };
+
+            // Commutative operation takes segment of any child that has
+            // already come, otherwise children are taken in rank order.
+            struct messege_t *ans = NULL;
+            int level = 0;
+            if (op_commutative(op)) {
+                progress_pending();
+                pthread_mutex_lock(&mutex);
+                for (; level <= highest_pow2(comm->size) && ans == NULL; level++) {
+                    if (!waiting_for_child[level])
+                        continue;
+                    info_to_recv.from = comm->world_ranks[(comm->rank + pow2[level]) % comm->size];
+                    ans = find_match(&info_to_recv);
+                }
+                if (ans != NULL)
+                    take_messege_from_list(ans);
+                pthread_mutex_unlock(&mutex);
+                level--;
+            }
+
+            if (ans == NULL) {
+                for (level = 0; !waiting_for_child[level]; level++);
+                info_to_recv.from = comm->world_ranks[(comm->rank + pow2[level]) % comm->size];
+
+                MIMPI_Retcode return_code = receive_messege(&info_to_recv, &ans);
+                if (return_code != MIMPI_SUCCESS) {
+                    if (own_bufor)
+                        free(data_cpy);
+                    return return_code;
+                }
+            }
+
+            perform_operation(data_cpy + offset, ans->data, segment_length, op);
+            free_messege(ans);
+
+            waiting_for_child[level] = false;
+            children_left--;
+        }
+
+        if (level_of_sending_data != -1) {
+            struct meta_data_t info_to_send = {
+                .messege_type = Reduction, 
+                .context      = comm->context,
+                .from         = world_rank, 
+                .count        = segment_length, 
+                .tag          = op + 1, 
+            };
+
+            send_messege(comm->world_ranks[parent], &info_to_send, data_cpy + offset);
+        }
+    }
+
+    // Result of non commutative operation is moved from 0 to root.
+    if (tree_root != root && count > 0) {
+        if (comm->rank == tree_root) {
+            struct meta_data_t info_to_send = {
+                .messege_type = Reduction, 
+                .context      = comm->context,
+                .from         = world_rank, 
+                .count        = count, 
+                .tag          = op + 1, 
+            };
+
+            send_messege(comm->world_ranks[root], &info_to_send, data_cpy);
+        } else if (comm->rank == root) {
+            struct meta_data_t info_to_recv = {
+                .messege_type = Reduction, 
+                .context      = comm->context,
+                .from         = comm->world_ranks[tree_root], 
+                .count        = count, 
+                .tag          = op + 1, 
+            };
+
+            struct messege_t *ans;
+            MIMPI_Retcode return_code = receive_messege(&info_to_recv, &ans);
+            if (return_code != MIMPI_SUCCESS) {
+                if (own_bufor)
+                    free(data_cpy);
+                return return_code;
+            }
+
+            memcpy(recv_data, ans->data, count);
+            free_messege(ans);
+        }
+    }
+
+    // Part 2 - empty messeges on remaining edges, so that every process
+    // learns when some other process has ended.
+    for (int level = 0; level <= highest_pow2(comm->size); level++) {
+        // Sending messege forward.
+        int where_to = (comm->size + comm->rank - pow2[level]) % comm->size;
+        if (level != level_of_sending_data) {
+            struct meta_data_t info_to_send = {
+                .messege_type = Reduction, 
+                .context      = comm->context,
+                .from         = world_rank, 
+                .count        = 0, 
+                .tag          = op + 1, 
+            };
+
+            send_messege(comm->world_ranks[where_to], &info_to_send, NULL);
+        }
+
+        // Reading messege from back.
+        int where_from = (comm->rank + pow2[level]) % comm->size;
+        if (get_sending_level_Reduce(where_from, tree_root, comm->size) != level) {
+            struct meta_data_t info_to_recv = {
+                .messege_type = Reduction, 
+                .context      = comm->context,
+                .from         = comm->world_ranks[where_from], 
+                .count        = 0, 
+                .tag          = op + 1, 
+            };
+
+            struct messege_t *ans;
+            MIMPI_Retcode return_code = receive_messege(&info_to_recv, &ans);
+            if (return_code != MIMPI_SUCCESS) {
+                if (own_bufor)
+                    free(data_cpy);
+                return return_code;
+            }
+
+            free_messege(ans);
+        }
+    }
+    
+    if (comm->rank == root && tree_root == root && data_cpy != recv_data)
+        memcpy(recv_data, data_cpy, count);
+
+    if (own_bufor)
+        free(data_cpy);
+    return MIMPI_SUCCESS;
+}
+
+// Computes data = lower op data, where lower comes from lower ranks.
+static void perform_operation_from_lower(uint8_t *data, uint8_t *lower, uint8_t *tmp, int count, MIMPI_Op op) {
+    memcpy(tmp, lower, count);
+    perform_operation(tmp, data, count, op);
+    memcpy(data, tmp, count);
+}
+
+// Recursive doubling: in level with distance d every process sends
+// reduction of its window of ranks to process d further, and extends
+// own window with one received from process d before.
+static MIMPI_Retcode scan_comm(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op,
+    MIMPI_Comm comm,
+    bool exclusive
+) {
+    uint8_t *window = malloc(count);
+    uint8_t *tmp = malloc(count);
+    ASSERT_ZERO(count > 0 && (window == NULL || tmp == NULL));
+    memcpy(window, (send_data == MIMPI_IN_PLACE) ? recv_data : send_data, count);
+
+    // In exclusive scan recv_data holds reduction of ranks before window.
+    bool got_lower = false;
+    MIMPI_Retcode return_code = MIMPI_SUCCESS;
+
+    for (int distance = 1; distance < comm->size; distance *= 2) {
+        if (comm->rank + distance < comm->size) {
+            struct meta_data_t info_to_send = {
+                .messege_type = Scan, 
+                .context      = comm->context,
+                .from         = world_rank, 
+                .count        = count, 
+                .tag          = op + 1, 
+            };
+
+            send_messege(comm->world_ranks[comm->rank + distance], &info_to_send, window);
+        }
+
+        if (comm->rank - distance < 0)
+            continue;
+
+        struct meta_data_t info_to_recv = {
+            .messege_type = Scan, 
+            .context      = comm->context,
+            .from         = comm->world_ranks[comm->rank - distance], 
+            .count        = count, 
+            .tag          = op + 1, 
+        };
+
+        struct messege_t *ans;
+        return_code = receive_messege(&info_to_recv, &ans);
+        if (return_code != MIMPI_SUCCESS)
+            break;
+
+        if (exclusive) {
+            if (got_lower)
+                perform_operation_from_lower(recv_data, ans->data, tmp, count, op);
+            else
+                memcpy(recv_data, ans->data, count);
+            got_lower = true;
+        }
+        perform_operation_from_lower(window, ans->data, tmp, count, op);
+
+        free_messege(ans);
+    }
+
+    if (return_code == MIMPI_SUCCESS && !exclusive)
+        memcpy(recv_data, window, count);
+
+    free(window);
+    free(tmp);
+    return return_code;
+}
+
+MIMPI_Retcode MIMPI_Scan(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op
+) {
+    return MIMPI_Scan_comm(send_data, recv_data, count, op, MIMPI_COMM_WORLD);
+}
+
+MIMPI_Retcode MIMPI_Scan_comm(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op,
+    MIMPI_Comm comm
+) {
+    return scan_comm(send_data, recv_data, count, op, comm, false);
+}
+
+MIMPI_Retcode MIMPI_Exscan(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op
+) {
+    return MIMPI_Exscan_comm(send_data, recv_data, count, op, MIMPI_COMM_WORLD);
+}
+
+MIMPI_Retcode MIMPI_Exscan_comm(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op,
+    MIMPI_Comm comm
+) {
+    return scan_comm(send_data, recv_data, count, op, comm, true);
+}
+
+// ---- BEGIN Implementation of nonblocking collectives.
+
+// Collectives started and not completed yet (linked by next_request).
+static struct request_t *first_collective = NULL;
+
+static void add_collective_to_list(struct request_t *request) {
+    request->next_request = first_collective;
+    first_collective = request;
+}
+
+static void remove_collective_from_list(struct request_t *request) {
+    struct request_t **place = &first_collective;
+    while (*place != request)
+        place = &(*place)->next_request;
+    *place = request->next_request;
+}
+
+// Send and receive of single step; ranks are in communicator, -1 means none.
+struct step_t {
+    int send_to;
+    int send_count;
+    int recv_from;
+    int recv_count;
+};
+
+// Steps are rounds of the same trees as in blocking collectives.
+static int collective_steps(struct request_t *request) {
+    int size = request->comm->size;
+
+    switch (request->coll.type) {
+    case Barrier:
+        return highest_pow2(size) + (pow2[highest_pow2(size)] < size ? 1 : 0);
+    case Bcast:
+        return highest_pow2(size) + 1;
+    default:
+        // Additional step moves result of non commutative operation from 0 to root.
+        return highest_pow2(size) + 2;
+    }
+}
+
+static void collective_step(struct request_t *request, struct step_t *step) {
+    struct collective_t *coll = &request->coll;
+    int rank = request->comm->rank;
+    int size = request->comm->size;
+    int root = coll->root;
+
+    step->send_to = step->recv_from = -1;
+    step->send_count = step->recv_count = 0;
+
+    if (coll->type == Barrier) {
+        step->send_to = (size + rank - pow2[coll->step]) % size;
+        step->recv_from = (rank + pow2[coll->step]) % size;
+    } else if (coll->type == Bcast) {
+        int level = highest_pow2(size) - coll->step;
+        step->send_to = (size + rank - pow2[level]) % size;
+        step->recv_from = (rank + pow2[level]) % size;
+        if (level == get_level_of_getting_data_Bcast(step->send_to, root, size))
+            step->send_count = coll->count;
+        if (level == get_level_of_getting_data_Bcast(rank, root, size))
+            step->recv_count = coll->count;
+    } else {
+        int tree_root = op_commutative(coll->op) ? root : 0;
+        int level = coll->step;
+
+        if (level <= highest_pow2(size)) {
+            step->send_to = (size + rank - pow2[level]) % size;
+            step->recv_from = (rank + pow2[level]) % size;
+            if (level == get_sending_level_Reduce(rank, tree_root, size))
+                step->send_count = coll->count;
+            if (level == get_sending_level_Reduce(step->recv_from, tree_root, size))
+                step->recv_count = coll->count;
+        } else if (tree_root != root && coll->count > 0) {
+            if (rank == tree_root) {
+                step->send_to = root;
+                step->send_count = coll->count;
+            } else if (rank == root) {
+                step->recv_from = tree_root;
+                step->recv_count = coll->count;
+            }
+        }
+    }
+}
+
+// Does as many steps as possible without waiting. Handler thread can't send
+// big messeges, as it would stop reading while waiting for space in channel.
+// Returns true if collective is done. Requires advancing to be set.
+static bool advance_collective(struct request_t *request, bool may_send_big) {
+    struct collective_t *coll = &request->coll;
+    MIMPI_Comm comm = request->comm;
+
+    while (coll->step < collective_steps(request)) {
+        struct step_t step;
+        collective_step(request, &step);
+
+        if (!coll->sent && step.send_to != -1) {
+            if (step.send_count > META_DATA_MINI_BUFOR_SIZE && !may_send_big) {
+                coll->needs_main = true;
+                return false;
+            }
+
+            struct meta_data_t info = {
+                .messege_type = coll->type,
+                .context      = internal_context(comm),
+                .from         = world_rank,
+                .count        = step.send_count,
+                .tag          = coll->tag,
+            };
+
+            send_messege(comm->world_ranks[step.send_to], &info, coll->data);
+        }
+        coll->sent = true;
+
+        if (step.recv_from != -1) {
+            struct meta_data_t key = {
+                .messege_type = coll->type,
+                .context      = internal_context(comm),
+                .from         = comm->world_ranks[step.recv_from],
+                .count        = step.recv_count,
+                .tag          = coll->tag,
+            };
+            coll->recv_key = key;
+            coll->wake_key.from = key.from;
+
+            pthread_mutex_lock(&mutex);
+            struct messege_t *ans = find_match(&key);
+            if (ans != NULL)
+                take_messege_from_list(ans);
+            pthread_mutex_unlock(&mutex);
+
+            if (ans == NULL)
+                return false;
+
+            if (step.recv_count > 0) {
+                if (coll->type == Bcast)
+                    memcpy(coll->data, ans->data, step.recv_count);
+                else if (coll->step <= highest_pow2(comm->size))
+                    perform_operation(coll->data, ans->data, step.recv_count, coll->op);
+                else
+                    memcpy(coll->recv_data, ans->data, step.recv_count);
+            }
+            free_messege(ans);
+        }
+
+        coll->step++;
+        coll->sent = false;
+    }
+
+    return true;
+}
+
+// Advances collective unless other thread does it already. Requires mutex.
+static void progress_collective_locked(struct request_t *request, bool may_send_big) {
+    struct collective_t *coll = &request->coll;
+
+    if (request->completed)
+        return;
+
+    if (coll->advancing) {
+        coll->again = true;
+        return;
+    }
+
+    coll->advancing = true;
+    bool done;
+    do {
+        coll->again = false;
+        if (may_send_big)
+            coll->needs_main = false;
+
+        pthread_mutex_unlock(&mutex);
+        done = advance_collective(request, may_send_big);
+        pthread_mutex_lock(&mutex);
+    } while (coll->again && !done);
+    coll->advancing = false;
+
+    if (done) {
+        int tree_root = op_commutative(coll->op) ? coll->root : 0;
+        if (coll->type == Reduction && request->comm->rank == coll->root &&
+            tree_root == coll->root && (void *)coll->data != coll->recv_data)
+            memcpy(coll->recv_data, coll->data, coll->count);
+
+        remove_collective_from_list(request);
+        request->completed = true;
+        request->result = MIMPI_SUCCESS;
+    }
+
+    // Main program could be waiting for this collective.
+    if (wait_line == &coll->wake_key && wanted_messege == NULL) {
+        struct messege_t *wake_messege = malloc(sizeof(struct messege_t));
+        ASSERT_ZERO(wake_messege == NULL);
+        wake_messege->info = coll->wake_key;
+        wake_messege->data = NULL;
+
+        wanted_messege = wake_messege;
+        wake_main_thread();
+    }
+}
+
+static void progress_nonblocking_collective(int context, int tag) {
+    pthread_mutex_lock(&mutex);
+
+    struct request_t *request = first_collective;
+    while (request != NULL && (internal_context(request->comm) != context || request->coll.tag != tag))
+        request = request->next_request;
+
+    if (request != NULL)
+        progress_collective_locked(request, false);
+
+    pthread_mutex_unlock(&mutex);
+}
+
+static void test_collective(struct request_t *request) {
+    progress_pending();
+
+    pthread_mutex_lock(&mutex);
+    progress_collective_locked(request, true);
+    pthread_mutex_unlock(&mutex);
+}
+
+static MIMPI_Retcode wait_collective(struct request_t *request) {
+    struct collective_t *coll = &request->coll;
+
+    pthread_mutex_lock(&mutex);
+
+    while (true) {
+        progress_collective_locked(request, true);
+
+        if (request->completed)
+            break;
+
+        // Handler left big send for us.
+        if (coll->needs_main && !coll->advancing)
+            continue;
+
+        // Awaited messege will never come.
+        if (!coll->advancing && has_ended[coll->recv_key.from] && find_match(&coll->recv_key) == NULL) {
+            remove_collective_from_list(request);
+            request->completed = true;
+            request->result = MIMPI_ERROR_REMOTE_FINISHED;
+            break;
+        }
+
+        free_messege(wait_for_wanted_messege(&coll->wake_key));
+    }
+
+    request->active = false;
+    pthread_mutex_unlock(&mutex);
+
+    return request->result;
+}
+
+// Creates and starts nonblocking collective.
+static MIMPI_Retcode start_collective(
+    enum messege_type_t type,
+    void *data,
+    void *recv_data,
+    bool own_data,
+    int count,
+    MIMPI_Op op,
+    int root,
+    MIMPI_Comm comm,
+    MIMPI_Request *request
+) {
+    struct request_t *new_request = malloc(sizeof(struct request_t));
+    ASSERT_ZERO(new_request == NULL);
+
+    new_request->kind      = Collective_request;
+    new_request->comm      = comm;
+    new_request->peer      = MIMPI_UNDEFINED;
+    new_request->data      = NULL;
+    new_request->active    = true;
+    new_request->posted    = false;
+    new_request->completed = false;
+    new_request->result    = MIMPI_SUCCESS;
+
+    struct collective_t *coll = &new_request->coll;
+    coll->type       = type;
+    coll->root       = root;
+    coll->op         = op;
+    coll->count      = count;
+    coll->tag        = ++comm->collectives_started;
+    coll->data       = data;
+    coll->recv_data  = recv_data;
+    coll->own_data   = own_data;
+    coll->step       = 0;
+    coll->sent       = false;
+    coll->advancing  = false;
+    coll->again      = false;
+    coll->needs_main = false;
+
+    struct meta_data_t wake_key = {
+        .messege_type = Collective_progress,
+        .context      = internal_context(comm),
+        .from         = world_rank,
+        .tag          = coll->tag,
+    };
+    coll->wake_key = wake_key;
+
+    pthread_mutex_lock(&mutex);
+    add_collective_to_list(new_request);
+    progress_collective_locked(new_request, true);
+    pthread_mutex_unlock(&mutex);
+
+    *request = new_request;
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Ibarrier(MIMPI_Comm comm, MIMPI_Request *request) {
+    return start_collective(Barrier, NULL, NULL, false, 0, MIMPI_SUM, 0, comm, request);
+}
+
+MIMPI_Retcode MIMPI_Ibcast(
+    void *data,
+    int count,
+    int root,
+    MIMPI_Comm comm,
+    MIMPI_Request *request
+) {
+    if (root < 0 || comm->size <= root)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    return start_collective(Bcast, data, NULL, false, count, MIMPI_SUM, root, comm, request);
+}
+
+MIMPI_Retcode MIMPI_Ireduce(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op,
+    int root,
+    MIMPI_Comm comm,
+    MIMPI_Request *request
+) {
+    if (root < 0 || comm->size <= root)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    if (send_data == MIMPI_IN_PLACE)
+        return start_collective(Reduction, recv_data, recv_data, false, count, op, root, comm, request);
+
+    uint8_t *data_cpy = malloc(count);
+    ASSERT_ZERO(data_cpy == NULL);
+    memcpy(data_cpy, send_data, count);
+
+    return start_collective(Reduction, data_cpy, recv_data, true, count, op, root, comm, request);
+}
+
+// ---- END Implementation of nonblocking collectives.
+
+// Gathers count bytes from every process of comm into recv_data, ordered by rank.
+static MIMPI_Retcode comm_allgather(MIMPI_Comm comm, void const *send_data, int count, void *recv_data) {
+    memcpy(recv_data + comm->rank * count, send_data, count);
+
+    if (comm->rank != 0) {
+        struct meta_data_t info_to_send = {
+            .messege_type = Allgather, 
+            .context      = comm->context,
+            .from         = world_rank, 
+            .count        = count, 
+            .tag          = 0, 
+        };
+
+        if (send_messege(comm->world_ranks[0], &info_to_send, send_data) == -1)
+            return MIMPI_ERROR_REMOTE_FINISHED;
+    } else {
+        for (int i = 1; i < comm->size; i++) {
+            struct meta_data_t info_to_recv = {
+                .messege_type = Allgather, 
+                .context      = comm->context,
+                .from         = comm->world_ranks[i], 
+                .count        = count, 
+                .tag          = 0, 
+            };
+
+            struct messege_t *ans;
+            MIMPI_Retcode return_code = receive_messege(&info_to_recv, &ans);
+            if (return_code != MIMPI_SUCCESS)
+                return return_code;
+
+            memcpy(recv_data + i * count, ans->data, count);
+            free_messege(ans);
+        }
+    }
+
+    return MIMPI_Bcast_comm(recv_data, comm->size * count, 0, comm);
+}
+
+int MIMPI_Comm_size(MIMPI_Comm comm) {
+    return comm->size;
+}
+
+int MIMPI_Comm_rank(MIMPI_Comm comm) {
+    return comm->rank;
+}
+
+struct split_entry_t {
+    int color;
+    int key;
+    int rank;
+    int next_context;
+};
+
+MIMPI_Retcode MIMPI_Comm_split(
+    MIMPI_Comm comm,
+    int color,
+    int key,
+    MIMPI_Comm *newcomm
+) {
+    struct split_entry_t my_entry = {
+        .color        = color,
+        .key          = key,
+        .rank         = comm->rank,
+        .next_context = next_context
+    };
+
+    struct split_entry_t *entries = malloc(comm->size * sizeof(struct split_entry_t));
+    ASSERT_ZERO(entries == NULL);
+
+    MIMPI_Retcode return_code = comm_allgather(comm, &my_entry, sizeof(struct split_entry_t), entries);
+    if (return_code != MIMPI_SUCCESS) {
+        free(entries);
+        return return_code;
+    }
+
+    // Context not used yet by any process of comm, so all new communicators can share it.
+    int context = 0;
+    for (int i = 0; i < comm->size; i++)
+        if (entries[i].next_context > context)
+            context = entries[i].next_context;
+    next_context = context + 1;
+
+    if (color == MIMPI_UNDEFINED) {
+        free(entries);
+        *newcomm = MIMPI_COMM_NULL;
+        return MIMPI_SUCCESS;
+    }
+
+    // Keeping only processes of same color, ordered by (key, rank).
+    int new_size = 0;
+    for (int i = 0; i < comm->size; i++) {
+        if (entries[i].color != color)
+            continue;
+
+        // Copied, as shifting may overwrite entries[i] when j reaches i.
+        struct split_entry_t entry = entries[i];
+        int j = new_size++;
+        while (j > 0 && (entries[j - 1].key > entry.key ||
+                         (entries[j - 1].key == entry.key && entries[j - 1].rank > entry.rank))) {
+            entries[j] = entries[j - 1];
+            j--;
+        }
+        entries[j] = entry;
+    }
+
+    struct comm_t *new_comm = malloc(sizeof(struct comm_t));
+    ASSERT_ZERO(new_comm == NULL);
+    new_comm->context = context;
+    new_comm->size = new_size;
+    new_comm->neighbors_cnt = 0;
+    new_comm->neighbors = NULL;
+    new_comm->collectives_started = 0;
+    new_comm->world_ranks = malloc(new_size * sizeof(int));
+    ASSERT_ZERO(new_comm->world_ranks == NULL);
+
+    for (int i = 0; i < new_size; i++) {
+        new_comm->world_ranks[i] = comm->world_ranks[entries[i].rank];
+        if (entries[i].rank == comm->rank)
+            new_comm->rank = i;
+    }
+
+    free(entries);
+    *newcomm = new_comm;
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Comm_dup(MIMPI_Comm comm, MIMPI_Comm *newcomm) {
+    return MIMPI_Comm_split(comm, 0, comm->rank, newcomm);
+}
+
+void MIMPI_Comm_free(MIMPI_Comm *comm) {
+    if (*comm == MIMPI_COMM_NULL || *comm == MIMPI_COMM_WORLD)
+        return;
+
+    free((*comm)->world_ranks);
+    free((*comm)->neighbors);
+    free(*comm);
+    *comm = MIMPI_COMM_NULL;
+}
+
+// ---- BEGIN Implementation of neighbourhood collectives.
+
+// Duplicates comm and gives it neighbours (taking ownership of the array).
+static MIMPI_Retcode topology_create(
+    MIMPI_Comm comm,
+    int neighbors_cnt,
+    struct neighbor_t *neighbors,
+    MIMPI_Comm *newcomm
+) {
+    MIMPI_Retcode return_code = MIMPI_Comm_dup(comm, newcomm);
+    if (return_code != MIMPI_SUCCESS) {
+        free(neighbors);
+        return return_code;
+    }
+
+    (*newcomm)->neighbors_cnt = neighbors_cnt;
+    (*newcomm)->neighbors = neighbors;
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Cart_create(
+    MIMPI_Comm comm,
+    int ndims,
+    int const *dims,
+    bool const *periods,
+    MIMPI_Comm *newcomm
+) {
+    int cells = 1;
+    for (int d = 0; d < ndims; d++)
+        cells *= dims[d];
+    if (cells != comm->size)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    struct neighbor_t *neighbors = malloc(2 * ndims * sizeof(struct neighbor_t));
+    ASSERT_ZERO(neighbors == NULL);
+
+    // Ranks are laid out in row-major order. Messege sent towards higher
+    // coordinate comes from lower neighbour of receiver and vice versa.
+    int stride = comm->size;
+    for (int d = 0; d < ndims; d++) {
+        stride /= dims[d];
+        int coord = (comm->rank / stride) % dims[d];
+
+        for (int dir = 0; dir < 2; dir++) {
+            int neighbor_coord = coord + (dir == 0 ? -1 : 1);
+            struct neighbor_t *neighbor = &neighbors[2 * d + dir];
+
+            if (!periods[d] && (neighbor_coord < 0 || dims[d] <= neighbor_coord))
+                neighbor->rank = MIMPI_UNDEFINED;
+            else
+                neighbor->rank = comm->rank + ((neighbor_coord + dims[d]) % dims[d] - coord) * stride;
+
+            neighbor->send_tag = 2 * d + dir + 1;
+            neighbor->recv_tag = 2 * d + (1 - dir) + 1;
+        }
+    }
+
+    return topology_create(comm, 2 * ndims, neighbors, newcomm);
+}
+
+MIMPI_Retcode MIMPI_Graph_create(
+    MIMPI_Comm comm,
+    int neighbors_cnt,
+    int const *neighbor_ranks,
+    MIMPI_Comm *newcomm
+) {
+    for (int i = 0; i < neighbors_cnt; i++)
+        if (neighbor_ranks[i] < 0 || comm->size <= neighbor_ranks[i])
+            return MIMPI_ERROR_NO_SUCH_RANK;
+
+    struct neighbor_t *neighbors = malloc(neighbors_cnt * sizeof(struct neighbor_t));
+    ASSERT_ZERO(neighbors == NULL);
+
+    // Repeated neighbours are told apart by order of messeges.
+    for (int i = 0; i < neighbors_cnt; i++) {
+        neighbors[i].rank = neighbor_ranks[i];
+        neighbors[i].send_tag = 1;
+        neighbors[i].recv_tag = 1;
+    }
+
+    return topology_create(comm, neighbors_cnt, neighbors, newcomm);
+}
+
+int MIMPI_Neighbors_count(MIMPI_Comm comm) {
+    return comm->neighbors_cnt;
+}
+
+// Process can be its own neighbour (e.g. in periodic dimension of size 1).
+// Data sent to itself through neighbour i goes, without any channel, to
+// place of receive from itself with the same tag, taken in order as messeges
+// would be matched.
+static void copy_to_self_neighbor(
+    void const *send_data,
+    int send_stride,
+    void *recv_data,
+    int count,
+    MIMPI_Comm comm,
+    int i
+) {
+    struct neighbor_t *neighbors = comm->neighbors;
+    int tag = neighbors[i].send_tag;
+
+    int order = 0;
+    for (int j = 0; j < i; j++)
+        if (neighbors[j].rank == comm->rank && neighbors[j].send_tag == tag)
+            order++;
+
+    for (int j = 0; j < comm->neighbors_cnt; j++) {
+        if (neighbors[j].rank != comm->rank || neighbors[j].recv_tag != tag)
+            continue;
+
+        if (order-- == 0) {
+            memcpy((uint8_t *)recv_data + j * count, (uint8_t const *)send_data + i * send_stride, count);
+            return;
+        }
+    }
+}
+
+// Posts receives from all neighbours, then sends to all of them, so that
+// all transfers go on at once. Neighbour i gets send_data + i * send_stride.
+static MIMPI_Retcode neighbor_exchange(
+    void const *send_data,
+    int send_stride,
+    void *recv_data,
+    int count,
+    MIMPI_Comm comm
+) {
+    struct request_t *requests = malloc(comm->neighbors_cnt * sizeof(struct request_t));
+    ASSERT_ZERO(requests == NULL);
+
+    for (int i = 0; i < comm->neighbors_cnt; i++) {
+        struct neighbor_t *neighbor = &comm->neighbors[i];
+        if (neighbor->rank == MIMPI_UNDEFINED || neighbor->rank == comm->rank)
+            continue;
+
+        init_recv_request(&requests[i], recv_data + i * count, count, neighbor->rank, neighbor->recv_tag, comm);
+        requests[i].info.context = internal_context(comm);
+        start_recv_request(&requests[i]);
+    }
+
+    MIMPI_Retcode return_code = MIMPI_SUCCESS;
+
+    for (int i = 0; i < comm->neighbors_cnt; i++) {
+        struct neighbor_t *neighbor = &comm->neighbors[i];
+        if (neighbor->rank == MIMPI_UNDEFINED)
+            continue;
+
+        if (neighbor->rank == comm->rank) {
+            copy_to_self_neighbor(send_data, send_stride, recv_data, count, comm, i);
+            continue;
+        }
+
+        struct meta_data_t info = {
+            .messege_type = PtP_messege,
+            .context      = internal_context(comm),
+            .from         = world_rank,
+            .count        = count,
+            .tag          = neighbor->send_tag
+        };
+
+        if (send_messege(comm->world_ranks[neighbor->rank], &info, send_data + i * send_stride) == -1)
+            return_code = MIMPI_ERROR_REMOTE_FINISHED;
+    }
+
+    for (int i = 0; i < comm->neighbors_cnt; i++) {
+        if (comm->neighbors[i].rank == MIMPI_UNDEFINED || comm->neighbors[i].rank == comm->rank)
+            continue;
+
+        MIMPI_Retcode request_code = wait_recv_request(&requests[i]);
+        if (return_code == MIMPI_SUCCESS)
+            return_code = request_code;
+    }
+
+    free(requests);
+    return return_code;
+}
+
+MIMPI_Retcode MIMPI_Neighbor_allgather(
+    void const *send_data,
+    int count,
+    void *recv_data,
+    MIMPI_Comm comm
+) {
+    return neighbor_exchange(send_data, 0, recv_data, count, comm);
+}
+
+MIMPI_Retcode MIMPI_Neighbor_alltoall(
+    void const *send_data,
+    int count,
+    void *recv_data,
+    MIMPI_Comm comm
+) {
+    return neighbor_exchange(send_data, count, recv_data, count, comm);
+}
+
+// ---- END Implementation of neighbourhood collectives.
+
+// ---- BEGIN Implementation of one-sided windows.
+
+// Beginning of every window segment, followed by window's memory.
+struct win_segment_t {
+    pthread_mutex_t lock;
+    int size;
+};
+
+// Every process maps segments of all processes of window's communicator.
+struct win_t {
+    MIMPI_Comm comm;
+    struct win_segment_t **segments;
+    bool *locked;   // Whether we hold lock of n-th segment.
+};
+
+static void win_segment_name(char *name, int context, int rank) {
+    sprintf(name, "/mimpi_%d_%d_%d", getppid(), context, rank);
+}
+
+static void *win_memory(struct win_segment_t *segment) {
+    return (void *)(segment + 1);
+}
+
+static void win_segment_lock(struct win_segment_t *segment) {
+    int result = pthread_mutex_lock(&segment->lock);
+
+    // Previous owner died holding the lock.
+    if (result == EOWNERDEAD)
+        result = pthread_mutex_consistent(&segment->lock);
+
+    ASSERT_ZERO(result);
+}
+
+static void win_check_access(MIMPI_Win win, int target, int offset, int count) {
+    if (offset < 0 || count < 0 || win->segments[target]->size < offset + count)
+        fatal("Access to bytes [%d, %d) is outside of window of size %d\n",
+              offset, offset + count, win->segments[target]->size);
+}
+
+static void win_release(MIMPI_Win win) {
+    for (int i = 0; i < win->comm->size; i++) {
+        if (win->segments[i] != NULL)
+            ASSERT_SYS_OK(munmap(win->segments[i], sizeof(struct win_segment_t) + win->segments[i]->size));
+    }
+
+    MIMPI_Comm_free(&win->comm);
+    free(win->segments);
+    free(win->locked);
+    free(win);
+}
+
+MIMPI_Retcode MIMPI_Win_allocate(
+    int size,
+    MIMPI_Comm comm,
+    void **base,
+    MIMPI_Win *win
+) {
+    // Separate context makes segment names unique and isolates fences.
+    MIMPI_Comm win_comm;
+    MIMPI_Retcode return_code = MIMPI_Comm_dup(comm, &win_comm);
+    if (return_code != MIMPI_SUCCESS)
+        return return_code;
+
+    struct win_t *new_win = malloc(sizeof(struct win_t));
+    ASSERT_ZERO(new_win == NULL);
+    new_win->comm = win_comm;
+    new_win->segments = calloc(win_comm->size, sizeof(struct win_segment_t *));
+    ASSERT_ZERO(new_win->segments == NULL);
+    new_win->locked = calloc(win_comm->size, sizeof(bool));
+    ASSERT_ZERO(new_win->locked == NULL);
+
+    char name[ENVVAR_LEN];
+    win_segment_name(name, win_comm->context, world_rank);
+
+    int fd;
+    size_t segment_size = sizeof(struct win_segment_t) + size;
+    ASSERT_SYS_OK(fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600));
+    ASSERT_SYS_OK(ftruncate(fd, segment_size));
+
+    struct win_segment_t *segment = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ASSERT_ZERO(segment == MAP_FAILED);
+    ASSERT_SYS_OK(close(fd));
+
+    pthread_mutexattr_t attr;
+    ASSERT_ZERO(pthread_mutexattr_init(&attr));
+    ASSERT_ZERO(pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED));
+    ASSERT_ZERO(pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST));
+    ASSERT_ZERO(pthread_mutex_init(&segment->lock, &attr));
+    ASSERT_ZERO(pthread_mutexattr_destroy(&attr));
+    segment->size = size;
+    new_win->segments[win_comm->rank] = segment;
+
+    // All segments exist after barrier.
+    return_code = MIMPI_Barrier_comm(win_comm);
+
+    for (int i = 0; i < win_comm->size && return_code == MIMPI_SUCCESS; i++) {
+        if (i == win_comm->rank)
+            continue;
+
+        struct stat stat_buf;
+        win_segment_name(name, win_comm->context, win_comm->world_ranks[i]);
+        ASSERT_SYS_OK(fd = shm_open(name, O_RDWR, 0600));
+        ASSERT_SYS_OK(fstat(fd, &stat_buf));
+
+        new_win->segments[i] = mmap(NULL, stat_buf.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ASSERT_ZERO(new_win->segments[i] == MAP_FAILED);
+        ASSERT_SYS_OK(close(fd));
+    }
+
+    // After everybody mapped all segments names are not needed anymore.
+    if (return_code == MIMPI_SUCCESS)
+        return_code = MIMPI_Barrier_comm(win_comm);
+
+    win_segment_name(name, win_comm->context, world_rank);
+    ASSERT_SYS_OK(shm_unlink(name));
+
+    if (return_code != MIMPI_SUCCESS) {
+        win_release(new_win);
+        return return_code;
+    }
+
+    *base = win_memory(segment);
+    *win = new_win;
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Win_free(MIMPI_Win *win) {
+    // Nobody can access our memory after barrier.
+    MIMPI_Retcode return_code = MIMPI_Barrier_comm((*win)->comm);
+
+    win_release(*win);
+    *win = NULL;
+
+    return return_code;
+}
+
+MIMPI_Retcode MIMPI_Put(
+    void const *origin_data,
+    int count,
+    int target,
+    int offset,
+    MIMPI_Win win
+) {
+    if (target < 0 || win->comm->size <= target)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    win_check_access(win, target, offset, count);
+    memcpy(win_memory(win->segments[target]) + offset, origin_data, count);
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Get(
+    void *origin_data,
+    int count,
+    int target,
+    int offset,
+    MIMPI_Win win
+) {
+    if (target < 0 || win->comm->size <= target)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    win_check_access(win, target, offset, count);
+    memcpy(origin_data, win_memory(win->segments[target]) + offset, count);
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Accumulate(
+    void const *origin_data,
+    int count,
+    MIMPI_Op op,
+    int target,
+    int offset,
+    MIMPI_Win win
+) {
+    if (target < 0 || win->comm->size <= target)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    win_check_access(win, target, offset, count);
+
+    // Accumulates are atomic with respect to each other.
+    if (!win->locked[target])
+        win_segment_lock(win->segments[target]);
+
+    perform_operation(win_memory(win->segments[target]) + offset, (uint8_t *)origin_data, count, op);
+
+    if (!win->locked[target])
+        ASSERT_ZERO(pthread_mutex_unlock(&win->segments[target]->lock));
+
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Win_fence(MIMPI_Win win) {
+    atomic_thread_fence(memory_order_seq_cst);
+    MIMPI_Retcode return_code = MIMPI_Barrier_comm(win->comm);
+    atomic_thread_fence(memory_order_seq_cst);
+    return return_code;
+}
+
+MIMPI_Retcode MIMPI_Win_lock(int target, MIMPI_Win win) {
+    if (target < 0 || win->comm->size <= target)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    win_segment_lock(win->segments[target]);
+    win->locked[target] = true;
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_Win_unlock(int target, MIMPI_Win win) {
+    if (target < 0 || win->comm->size <= target)
+        return MIMPI_ERROR_NO_SUCH_RANK;
+
+    win->locked[target] = false;
+    ASSERT_ZERO(pthread_mutex_unlock(&win->segments[target]->lock));
+    return MIMPI_SUCCESS;
+}
+
+// ---- END Implementation of one-sided windows.
+
+// ---- BEGIN Implementation of collective file I/O.
+
+// Collective I/O is done in two phases. File range accessed by all processes
+// is split into aligned domains, one per aggregator. In every round each
+// aggregator handles FILE_BUFFER bytes of its domain: processes send it their
+// pieces falling there (as list of pieces followed by data), and it writes
+// every contiguous run with single pwrite. Reading goes the other way: lists
+// of pieces go to aggregator, which reads whole region with single pread and
+// sends every process data of its pieces.
+#define FILE_AGGREGATORS_VAR "MIMPI_FILE_AGGREGATORS"
+#define FILE_ALIGN 4096
+#define FILE_BUFFER (4 * 1024 * 1024)
+#define FILE_TAG 1
+
+// Processes accessing single contiguous parts of at least that many bytes,
+// that don't overlap, do their I/O independently.
+#define FILE_INDEPENDENT_MIN (1024 * 1024)
+
+struct file_t {
+    MIMPI_Comm comm;
+    int desc;
+    int aggregators;
+};
+
+// Contiguous part of file, starting at byte position of data.
+struct file_piece_t {
+    size_t offset;
+    size_t length;
+    size_t position;
+};
+
+// Bytes [lo, hi) of file accessed by process, in pieces pieces.
+struct file_extent_t {
+    size_t lo;
+    size_t hi;
+    size_t pieces;
+    size_t length;
+};
+
+// domain - bytes of file of every aggregator, starting at base
+struct file_plan_t {
+    bool independent;
+    int aggregators;
+    int rounds;
+    size_t lo;
+    size_t hi;
+    size_t base;
+    size_t domain;
+};
+
+static size_t ceil_div(size_t a, size_t b) {
+    return (a + b - 1) / b;
+}
+
+static int compare_pieces(void const *a, void const *b) {
+    size_t offset_a = ((struct file_piece_t const *)a)->offset;
+    size_t offset_b = ((struct file_piece_t const *)b)->offset;
+    return (offset_a > offset_b) - (offset_a < offset_b);
+}
+
+// Lists pieces of count elements of filetype starting at offset, sorted
+// by offset, merging neighbouring ones.
+static int file_pieces(size_t offset, MIMPI_Datatype filetype, int count, struct file_piece_t **pieces) {
+    struct datatype_t *type = type_of(filetype);
+    *pieces = NULL;
+
+    if (count <= 0 || type->size == 0)
+        return 0;
+
+    if (type_contiguous(filetype)) {
+        *pieces = malloc(sizeof(struct file_piece_t));
+        ASSERT_ZERO(*pieces == NULL);
+        (*pieces)[0] = (struct file_piece_t){.offset = offset, .length = (size_t)count * type->size};
+        return 1;
+    }
+
+    *pieces = malloc((size_t)count * type->blocks_cnt * sizeof(struct file_piece_t));
+    ASSERT_ZERO(*pieces == NULL);
+
+    int pieces_cnt = 0;
+    size_t position = 0;
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; j < type->blocks_cnt; j++) {
+            long long start = (long long)offset + (long long)i * type->extent + type->blocks[j].offset;
+            if (start < 0)
+                fatal("Piece of file type starts before beginning of file\n");
+
+            struct file_piece_t *last = pieces_cnt > 0 ? &(*pieces)[pieces_cnt - 1] : NULL;
+            if (last != NULL && last->offset + last->length == (size_t)start) {
+                last->length += type->blocks[j].length;
+            } else {
+                (*pieces)[pieces_cnt++] = (struct file_piece_t){
+                    .offset = start, 
+                    .length = type->blocks[j].length, 
+                    .position = position
+                };
+            }
+            position += type->blocks[j].length;
+        }
+    }
+
+    qsort(*pieces, pieces_cnt, sizeof(struct file_piece_t), compare_pieces);
+    return pieces_cnt;
+}
+
+static void file_pwrite(int desc, uint8_t const *data, size_t length, size_t offset) {
+    while (length > 0) {
+        ssize_t result;
+        ASSERT_SYS_OK(result = pwrite(desc, data, length, offset));
+        data += result;
+        length -= result;
+        offset += result;
+    }
+}
+
+// Reads length bytes, filling bytes past end of file with zeros.
+static void file_pread(int desc, uint8_t *data, size_t length, size_t offset) {
+    while (length > 0) {
+        ssize_t result;
+        ASSERT_SYS_OK(result = pread(desc, data, length, offset));
+        if (result == 0) {
+            memset(data, 0, length);
+            return;
+        }
+        data += result;
+        length -= result;
+        offset += result;
+    }
+}
+
+// I/O of this process alone.
+static void file_independent(MIMPI_File file, struct file_piece_t *pieces, int pieces_cnt, uint8_t *data, bool writing) {
+    for (int i = 0; i < pieces_cnt; i++) {
+        if (writing)
+            file_pwrite(file->desc, data + pieces[i].position, pieces[i].length, pieces[i].offset);
+        else
+            file_pread(file->desc, data + pieces[i].position, pieces[i].length, pieces[i].offset);
+    }
+}
+
+static int compare_extents(void const *a, void const *b) {
+    size_t lo_a = ((struct file_extent_t const *)a)->lo;
+    size_t lo_b = ((struct file_extent_t const *)b)->lo;
+    return (lo_a > lo_b) - (lo_a < lo_b);
+}
+
+// Decides, the same way in every process, how accesses are split.
+static void file_plan(MIMPI_File file, struct file_extent_t *extents, struct file_plan_t *plan) {
+    int size = file->comm->size;
+    int used = 0;
+
+    plan->lo = SIZE_MAX;
+    plan->hi = 0;
+    plan->aggregators = min(file->aggregators, size);
+
+    bool big_contiguous = true;
+    for (int i = 0; i < size; i++) {
+        if (extents[i].pieces == 0)
+            continue;
+
+        extents[used++] = extents[i];
+        plan->lo = extents[i].lo < plan->lo ? extents[i].lo : plan->lo;
+        plan->hi = extents[i].hi > plan->hi ? extents[i].hi : plan->hi;
+        if (extents[i].pieces > 1 || extents[i].length < FILE_INDEPENDENT_MIN)
+            big_contiguous = false;
+    }
+
+    // Overlapping parts are not independent.
+    qsort(extents, used, sizeof(struct file_extent_t), compare_extents);
+    for (int i = 1; i < used; i++)
+        if (extents[i].lo < extents[i - 1].hi)
+            big_contiguous = false;
+
+    plan->independent = plan->aggregators == 0 || big_contiguous;
+    if (plan->independent || used == 0) {
+        plan->rounds = 0;
+        return;
+    }
+
+    plan->base = plan->lo / FILE_ALIGN * FILE_ALIGN;
+    plan->domain = ceil_div(ceil_div(plan->hi - plan->base, plan->aggregators), FILE_ALIGN) * FILE_ALIGN;
+    plan->rounds = ceil_div(plan->domain, FILE_BUFFER);
+}
+
+static int file_aggregator_rank(MIMPI_File file, struct file_plan_t *plan, int aggregator) {
+    return aggregator * file->comm->size / plan->aggregators;
+}
+
+// Gives bytes [lo, hi) of file handled by aggregator in round. Returns
+// whether there are any.
+static bool file_window(struct file_plan_t *plan, int aggregator, int round, size_t *lo, size_t *hi) {
+    size_t start = plan->base + aggregator * plan->domain;
+    size_t end = start + plan->domain;
+
+    *lo = start + (size_t)round * FILE_BUFFER;
+    *hi = *lo + FILE_BUFFER < end ? *lo + FILE_BUFFER : end;
+    *lo = *lo > plan->lo ? *lo : plan->lo;
+    *hi = *hi < plan->hi ? *hi : plan->hi;
+
+    return *lo < *hi;
+}
+
+// Packs list of parts of pieces within [lo, hi), followed by their data if
+// data is not NULL. Sets size to size of packed bytes and length to length
+// of data.
+static uint8_t *file_pack(struct file_piece_t *pieces, int pieces_cnt, size_t lo, size_t hi,
+                          uint8_t const *data, size_t *size, size_t *length) {
+    // First piece ending after lo.
+    int first = 0, last = pieces_cnt;
+    while (first < last) {
+        int middle = (first + last) / 2;
+        if (pieces[middle].offset + pieces[middle].length <= lo)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    uint64_t cnt = 0;
+    *length = 0;
+    for (int i = first; i < pieces_cnt && pieces[i].offset < hi; i++) {
+        size_t start = pieces[i].offset > lo ? pieces[i].offset : lo;
+        size_t end = pieces[i].offset + pieces[i].length < hi ? pieces[i].offset + pieces[i].length : hi;
+        cnt++;
+        *length += end - start;
+    }
+
+    *size = sizeof(uint64_t) * (1 + 2 * cnt) + (data != NULL ? *length : 0);
+    uint8_t *packed = malloc(*size);
+    ASSERT_ZERO(packed == NULL);
+
+    uint64_t *list = (uint64_t *)packed;
+    uint8_t *packed_data = packed + sizeof(uint64_t) * (1 + 2 * cnt);
+    *list++ = cnt;
+
+    for (int i = first; i < pieces_cnt && pieces[i].offset < hi; i++) {
+        size_t start = pieces[i].offset > lo ? pieces[i].offset : lo;
+        size_t end = pieces[i].offset + pieces[i].length < hi ? pieces[i].offset + pieces[i].length : hi;
+        *list++ = start;
+        *list++ = end - start;
+
+        if (data != NULL) {
+            memcpy(packed_data, data + pieces[i].position + (start - pieces[i].offset), end - start);
+            packed_data += end - start;
+        }
+    }
+
+    return packed;
+}
+
+// Scatters data of parts of pieces within [lo, hi) to their places.
+static void file_unpack(struct file_piece_t *pieces, int pieces_cnt, size_t lo, size_t hi,
+                        uint8_t const *packed_data, uint8_t *data) {
+    for (int i = 0; i < pieces_cnt; i++) {
+        if (pieces[i].offset + pieces[i].length <= lo || hi <= pieces[i].offset)
+            continue;
+
+        size_t start = pieces[i].offset > lo ? pieces[i].offset : lo;
+        size_t end = pieces[i].offset + pieces[i].length < hi ? pieces[i].offset + pieces[i].length : hi;
+        memcpy(data + pieces[i].position + (start - pieces[i].offset), packed_data, end - start);
+        packed_data += end - start;
+    }
+}
+
+// Receives packed messege of process i into packed (own is taken from own).
+static MIMPI_Retcode file_receive_packed(MIMPI_File file, int i, uint8_t *own, uint8_t **packed) {
+    if (i == file->comm->rank) {
+        *packed = own;
+        return MIMPI_SUCCESS;
+    }
+
+    MIMPI_Status status;
+    MIMPI_Retcode return_code = MIMPI_Probe(i, FILE_TAG, file->comm, &status);
+    if (return_code != MIMPI_SUCCESS)
+        return return_code;
+
+    *packed = malloc(status.count);
+    ASSERT_ZERO(*packed == NULL);
+
+    return_code = MIMPI_Recv_comm(*packed, status.count, i, FILE_TAG, file->comm);
+    if (return_code != MIMPI_SUCCESS)
+        free(*packed);
+    return return_code;
+}
+
+static int compare_runs(void const *a, void const *b) {
+    uint64_t offset_a = ((uint64_t const *)a)[0];
+    uint64_t offset_b = ((uint64_t const *)b)[0];
+    return (offset_a > offset_b) - (offset_a < offset_b);
+}
+
+// Gathers pieces of window [lo, hi) from all processes and writes every
+// contiguous run of them at once.
+static MIMPI_Retcode file_aggregate_write(MIMPI_File file, size_t lo, size_t hi, uint8_t *own) {
+    uint8_t *bufor = malloc(hi - lo);
+    ASSERT_ZERO(bufor == NULL);
+
+    uint64_t *runs = NULL;
+    size_t runs_cnt = 0;
+    MIMPI_Retcode return_code = MIMPI_SUCCESS;
+
+    for (int i = 0; i < file->comm->size && return_code == MIMPI_SUCCESS; i++) {
+        uint8_t *packed;
+        return_code = file_receive_packed(file, i, own, &packed);
+        if (return_code != MIMPI_SUCCESS)
+            break;
+
+        uint64_t *list = (uint64_t *)packed;
+        uint64_t cnt = *list++;
+        uint8_t *packed_data = (uint8_t *)(list + 2 * cnt);
+
+        runs = realloc(runs, (runs_cnt + cnt) * 2 * sizeof(uint64_t));
+        ASSERT_ZERO(runs_cnt + cnt > 0 && runs == NULL);
+
+        for (uint64_t j = 0; j < cnt; j++) {
+            memcpy(bufor + (list[2 * j] - lo), packed_data, list[2 * j + 1]);
+            packed_data += list[2 * j + 1];
+            runs[2 * runs_cnt] = list[2 * j];
+            runs[2 * runs_cnt + 1] = list[2 * j] + list[2 * j + 1];
+            runs_cnt++;
+        }
+
+        if (packed != own)
+            free(packed);
+    }
+
+    if (return_code == MIMPI_SUCCESS) {
+        qsort(runs, runs_cnt, 2 * sizeof(uint64_t), compare_runs);
+
+        size_t i = 0;
+        while (i < runs_cnt) {
+            uint64_t start = runs[2 * i];
+            uint64_t end = runs[2 * i + 1];
+            for (i++; i < runs_cnt && runs[2 * i] <= end; i++)
+                end = runs[2 * i + 1] > end ? runs[2 * i + 1] : end;
+
+            file_pwrite(file->desc, bufor + (start - lo), end - start, start);
+        }
+    }
+
+    free(runs);
+    free(bufor);
+    return return_code;
+}
+
+// Gathers lists of pieces of window [lo, hi) from all processes, reads
+// range covering all of them at once and sends every process its data.
+static MIMPI_Retcode file_aggregate_read(MIMPI_File file, size_t lo, size_t hi, uint8_t *own, uint8_t **own_data) {
+    int size = file->comm->size;
+    uint8_t **lists = calloc(size, sizeof(uint8_t *));
+    ASSERT_ZERO(lists == NULL);
+
+    size_t start = hi, end = lo;
+    MIMPI_Retcode return_code = MIMPI_SUCCESS;
+
+    for (int i = 0; i < size && return_code == MIMPI_SUCCESS; i++) {
+        return_code = file_receive_packed(file, i, own, &lists[i]);
+        if (return_code != MIMPI_SUCCESS) {
+            lists[i] = NULL;
+            break;
+        }
+
+        uint64_t *list = (uint64_t *)lists[i];
+        for (uint64_t j = 0; j < list[0]; j++) {
+            start = list[1 + 2 * j] < start ? list[1 + 2 * j] : start;
+            end = list[2 + 2 * j] + list[1 + 2 * j] > end ? list[2 + 2 * j] + list[1 + 2 * j] : end;
+        }
+    }
+
+    uint8_t *bufor = NULL;
+    if (return_code == MIMPI_SUCCESS && start < end) {
+        bufor = malloc(end - start);
+        ASSERT_ZERO(bufor == NULL);
+        file_pread(file->desc, bufor, end - start, start);
+    }
+
+    for (int i = 0; i < size && return_code == MIMPI_SUCCESS; i++) {
+        uint64_t *list = (uint64_t *)lists[i];
+        size_t length = 0;
+        for (uint64_t j = 0; j < list[0]; j++)
+            length += list[2 + 2 * j];
+
+        uint8_t *data = malloc(length);
+        ASSERT_ZERO(length > 0 && data == NULL);
+
+        uint8_t *place = data;
+        for (uint64_t j = 0; j < list[0]; j++) {
+            memcpy(place, bufor + (list[1 + 2 * j] - start), list[2 + 2 * j]);
+            place += list[2 + 2 * j];
+        }
+
+        if (i == file->comm->rank) {
+            *own_data = data;
+        } else {
+            return_code = MIMPI_Send_comm(data, length, i, FILE_TAG, file->comm);
+            free(data);
+        }
+    }
+
+    for (int i = 0; i < size; i++)
+        if (lists[i] != own)
+            free(lists[i]);
+    free(lists);
+    free(bufor);
+    return return_code;
+}
+
+// Collective I/O of pieces of this process (see beginning of this block).
+static MIMPI_Retcode file_collective(MIMPI_File file, struct file_piece_t *pieces, int pieces_cnt, uint8_t *data, bool writing) {
+    int size = file->comm->size;
+    struct file_extent_t extent = {.lo = 0, .hi = 0, .pieces = pieces_cnt, .length = 0};
+
+    for (int i = 0; i < pieces_cnt; i++) {
+        extent.lo = (i == 0 || pieces[i].offset < extent.lo) ? pieces[i].offset : extent.lo;
+        extent.hi = pieces[i].offset + pieces[i].length > extent.hi ? pieces[i].offset + pieces[i].length : extent.hi;
+        extent.length += pieces[i].length;
+    }
+
+    struct file_extent_t *extents = malloc(size * sizeof(struct file_extent_t));
+    ASSERT_ZERO(extents == NULL);
+
+    MIMPI_Retcode return_code = comm_allgather(file->comm, &extent, sizeof(struct file_extent_t), extents);
+    struct file_plan_t plan;
+    if (return_code == MIMPI_SUCCESS)
+        file_plan(file, extents, &plan);
+    free(extents);
+
+    if (return_code != MIMPI_SUCCESS)
+        return return_code;
+
+    if (plan.independent) {
+        file_independent(file, pieces, pieces_cnt, data, writing);
+        return MIMPI_SUCCESS;
+    }
+
+    // Aggregator handled by this process, if any.
+    int own_aggregator = -1;
+    for (int a = 0; a < plan.aggregators; a++)
+        if (file_aggregator_rank(file, &plan, a) == file->comm->rank)
+            own_aggregator = a;
+
+    uint8_t *own_packed = NULL;
+    size_t *lengths = malloc(plan.aggregators * sizeof(size_t));
+    ASSERT_ZERO(lengths == NULL);
+
+    // First all pieces (or their lists) go to aggregators, so that all of
+    // them work at the same time.
+    for (int round = 0; round < plan.rounds && return_code == MIMPI_SUCCESS; round++) {
+        for (int a = 0; a < plan.aggregators && return_code == MIMPI_SUCCESS; a++) {
+            size_t lo, hi, packed_size;
+            if (!file_window(&plan, a, round, &lo, &hi))
+                continue;
+
+            uint8_t *packed = file_pack(pieces, pieces_cnt, lo, hi, writing ? data : NULL, &packed_size, &lengths[a]);
+
+            if (a == own_aggregator) {
+                own_packed = packed;
+            } else {
+                return_code = MIMPI_Send_comm(packed, packed_size, file_aggregator_rank(file, &plan, a), FILE_TAG, file->comm);
+                free(packed);
+            }
+        }
+
+        size_t lo, hi;
+        uint8_t *own_data = NULL;
+        if (return_code == MIMPI_SUCCESS && own_aggregator != -1 && file_window(&plan, own_aggregator, round, &lo, &hi)) {
+            if (writing)
+                return_code = file_aggregate_write(file, lo, hi, own_packed);
+            else
+                return_code = file_aggregate_read(file, lo, hi, own_packed, &own_data);
+        }
+        free(own_packed);
+        own_packed = NULL;
+
+        // Data read by aggregators comes back.
+        for (int a = 0; a < plan.aggregators && return_code == MIMPI_SUCCESS && !writing; a++) {
+            if (!file_window(&plan, a, round, &lo, &hi))
+                continue;
+
+            uint8_t *packed_data = own_data;
+            if (a != own_aggregator) {
+                packed_data = malloc(lengths[a]);
+                ASSERT_ZERO(lengths[a] > 0 && packed_data == NULL);
+                return_code = MIMPI_Recv_comm(packed_data, lengths[a], file_aggregator_rank(file, &plan, a), FILE_TAG, file->comm);
+            }
+
+            if (return_code == MIMPI_SUCCESS)
+                file_unpack(pieces, pieces_cnt, lo, hi, packed_data, data);
+            if (a != own_aggregator)
+                free(packed_data);
+        }
+        free(own_data);
+    }
+
+    free(lengths);
+    return return_code;
+}
+
+MIMPI_Retcode MIMPI_File_open(
+    MIMPI_Comm comm,
+    char const *path,
+    int flags,
+    MIMPI_File *file
+) {
+    // Separate context keeps messeges of file away from user's ones.
+    MIMPI_Comm file_comm;
+    MIMPI_Retcode return_code = MIMPI_Comm_dup(comm, &file_comm);
+    if (return_code != MIMPI_SUCCESS)
+        return return_code;
+
+    struct file_t *new_file = malloc(sizeof(struct file_t));
+    ASSERT_ZERO(new_file == NULL);
+    new_file->comm = file_comm;
+    new_file->desc = -1;
+
+    char *aggregators_str = getenv(FILE_AGGREGATORS_VAR);
+    new_file->aggregators = aggregators_str == NULL ? (file_comm->size + 3) / 4 : string_to_no(aggregators_str);
+
+    // File is created or truncated once, before others open it.
+    if (file_comm->rank == 0)
+        ASSERT_SYS_OK(new_file->desc = open(path, flags, 0644));
+
+    return_code = MIMPI_Barrier_comm(file_comm);
+
+    if (return_code == MIMPI_SUCCESS && file_comm->rank != 0)
+        ASSERT_SYS_OK(new_file->desc = open(path, flags & ~(O_CREAT | O_EXCL | O_TRUNC)));
+
+    if (return_code != MIMPI_SUCCESS) {
+        if (new_file->desc != -1)
+            ASSERT_SYS_OK(close(new_file->desc));
+        MIMPI_Comm_free(&new_file->comm);
+        free(new_file);
+        return return_code;
+    }
+
+    *file = new_file;
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_File_close(MIMPI_File *file) {
+    // Everybody's writes are done after barrier.
+    MIMPI_Retcode return_code = MIMPI_Barrier_comm((*file)->comm);
+
+    ASSERT_SYS_OK(close((*file)->desc));
+    MIMPI_Comm_free(&(*file)->comm);
+    free(*file);
+    *file = NULL;
+
+    return return_code;
+}
+
+MIMPI_Retcode MIMPI_File_write_at(
+    MIMPI_File file,
+    size_t offset,
+    void const *data,
+    int count,
+    MIMPI_Datatype filetype
+) {
+    struct file_piece_t *pieces;
+    int pieces_cnt = file_pieces(offset, filetype, count, &pieces);
+
+    file_independent(file, pieces, pieces_cnt, (uint8_t *)data, true);
+    free(pieces);
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_File_read_at(
+    MIMPI_File file,
+    size_t offset,
+    void *data,
+    int count,
+    MIMPI_Datatype filetype
+) {
+    struct file_piece_t *pieces;
+    int pieces_cnt = file_pieces(offset, filetype, count, &pieces);
+
+    file_independent(file, pieces, pieces_cnt, data, false);
+    free(pieces);
+    return MIMPI_SUCCESS;
+}
+
+MIMPI_Retcode MIMPI_File_write_at_all(
+    MIMPI_File file,
+    size_t offset,
+    void const *data,
+    int count,
+    MIMPI_Datatype filetype
+) {
+    struct file_piece_t *pieces;
+    int pieces_cnt = file_pieces(offset, filetype, count, &pieces);
+
+    MIMPI_Retcode return_code = file_collective(file, pieces, pieces_cnt, (uint8_t *)data, true);
+    free(pieces);
+    return return_code;
+}
+
+MIMPI_Retcode MIMPI_File_read_at_all(
+    MIMPI_File file,
+    size_t offset,
+    void *data,
+    int count,
+    MIMPI_Datatype filetype
+) {
+    struct file_piece_t *pieces;
+    int pieces_cnt = file_pieces(offset, filetype, count, &pieces);
+
+    MIMPI_Retcode return_code = file_collective(file, pieces, pieces_cnt, data, false);
+    free(pieces);
+    return return_code;
+}
+
+// ---- END Implementation of collective file I/O.
@@ -2,8 +2,12 @@
 #define MIMPI_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #define MIMPI_ANY_TAG 0
+#define MIMPI_UNDEFINED (-1)
+#define MIMPI_ANY_SOURCE (-2)
+#define MIMPI_IN_PLACE ((void const *)1)
 
 /// Return code of MIMPI operations.
 typedef enum {
@@ -12,6 +16,7 @@ typedef enum {
     MIMPI_ERROR_NO_SUCH_RANK = 2, /// no process with requested rank exists in the world
     MIMPI_ERROR_REMOTE_FINISHED = 3, /// the remote process involved in communication has finished
     MIMPI_ERROR_DEADLOCK_DETECTED = 4, /// a deadlock has been detected
+    MIMPI_ERROR_NO_SUCH_OP = 5, /// reduction operation given is not valid
 } MIMPI_Retcode;
 
 /// @brief Reduction operation kind.
@@ -24,6 +29,56 @@ typedef enum {
     MIMPI_PROD,
 } MIMPI_Op;
 
+/// @brief Operation that is not valid, set by @ref MIMPI_Op_free().
+#define MIMPI_OP_NULL ((MIMPI_Op)-1)
+
+/// @brief User defined reduction function.
+///
+/// Combines @ref count elements: `inout[i] = inout[i] op in[i]`,
+/// where @ref inout holds data coming from lower ranks than @ref in.
+typedef void (*MIMPI_User_function)(void *inout, void const *in, int count);
+
+/// @brief Way in which incoming messages are read.
+typedef enum {
+    MIMPI_PROGRESS_THREAD,    /// dedicated thread reads all messages
+    MIMPI_PROGRESS_POLL,      /// calling thread reads messages inside MIMPI calls, sleeping in poll
+    MIMPI_PROGRESS_BUSY_POLL, /// as above, but spinning instead of sleeping
+} MIMPI_Progress;
+
+/// @brief Information about a message, filled by probing.
+typedef struct {
+    int source; /// rank of sender in the communicator
+    int tag;    /// tag of the message
+    int count;  /// number of bytes of the message
+} MIMPI_Status;
+
+/// @brief Communicator - a group of processes with its own ranks.
+///
+/// Messages sent within one communicator never match receives
+/// posted in other one.
+typedef struct comm_t *MIMPI_Comm;
+
+/// Communicator containing all processes launched by `mimpirun`.
+extern MIMPI_Comm const MIMPI_COMM_WORLD;
+
+/// Value of communicator handle that does not refer to any communicator.
+#define MIMPI_COMM_NULL ((MIMPI_Comm)0)
+
+/// @brief Handle of a persistent communication request.
+///
+/// Created by @ref MIMPI_Send_init() or @ref MIMPI_Recv_init(),
+/// started by @ref MIMPI_Start() and completed by @ref MIMPI_Wait().
+typedef struct request_t *MIMPI_Request;
+
+/// @brief Layout of possibly non-contiguous data.
+///
+/// Describes which bytes of one element belong to data; elements of
+/// data follow each other every extent bytes (end of last byte of element).
+typedef struct datatype_t *MIMPI_Datatype;
+
+/// Datatype of a single byte, i.e. of contiguous data.
+#define MIMPI_BYTE ((MIMPI_Datatype)0)
+
 /// @brief Initialises MIMPI framework in MIMPI programs.
 ///
 /// Opens an _MPI block_, permitting use of other MIMPI procedures.
@@ -31,8 +86,40 @@ typedef enum {
 ///        should be enabled or not. Note that this adds a considerable
 ///        overhead, so should only be used when needed.
 ///
+/// A blocked call first spins for its message before going to sleep;
+/// `MIMPI_SPIN_BUDGET` environment variable sets the number of spins.
+///
+/// Messages of at least `MIMPI_COMPRESS_THRESHOLD` bytes (environment
+/// variable, unset means never) are compressed, unless that does not save
+/// enough, in which case compression to that process pauses for a while.
+///
+/// If `MIMPI_GROUPS` environment variable gives group of every process
+/// (e.g. `0,0,1,1`), @ref MIMPI_Barrier(), @ref MIMPI_Bcast() and
+/// @ref MIMPI_Reduce() with commutative operation work first within groups
+/// and then among one process of each group. `MIMPI_GROUP_DELAY` slows
+/// sends between groups down by given milliseconds per 512 bytes.
+///
+/// Under `mimpirun` every process keeps counters in shared memory: what it
+/// is blocked on and on whom, messages and bytes sent to and received from
+/// every process, unexpected messages waiting and time spent blocked.
+/// `mimpitop <pid of mimpirun> [interval_ms]` shows them while job runs.
+///
 void MIMPI_Init(bool enable_deadlock_detection);
 
+/// @brief Initialises MIMPI framework with chosen progress mode.
+///
+/// Works as @ref MIMPI_Init(), which uses `MIMPI_PROGRESS_THREAD`.
+/// In polling modes no background thread is created: messages are read
+/// and matched by the calling thread inside blocking and probing calls,
+/// which saves thread handoffs on every message. Messages are then only
+/// received while the process is inside a MIMPI call (a send that does
+/// not fit into the channel also reads incoming messages while waiting).
+///
+/// @param enable_deadlock_detection - as in @ref MIMPI_Init().
+/// @param progress - way in which incoming messages are read.
+///
+void MIMPI_Init_progress(bool enable_deadlock_detection, MIMPI_Progress progress);
+
 /// @brief Finalises MIMPI framework in MIMPI programs.
 ///
 /// Closes an _MPI block_, freeing all MIMPI-related resources.
@@ -83,7 +170,8 @@ MIMPI_Retcode MIMPI_Send(
 ///
 /// @param data - place where received data is to be put.
 /// @param count - number of bytes of data to be received.
-/// @param source - rank of the process for data from we are waiting. 
+/// @param source - rank of the process for data from we are waiting
+///                 or `MIMPI_ANY_SOURCE` (see @ref MIMPI_Recv_comm()).
 /// @param tag - a discriminant of the data, which can be used
 ///              to distinguish between messages.
 /// @return MIMPI return code:
@@ -103,12 +191,303 @@ MIMPI_Retcode MIMPI_Recv(
     int tag
 );
 
+/// @brief Sends data to the specified process of a communicator.
+///
+/// Works as @ref MIMPI_Send(), but @ref destination is a rank in @ref comm
+/// and message can only be received within @ref comm.
+///
+MIMPI_Retcode MIMPI_Send_comm(
+    void const *data,
+    int count,
+    int destination,
+    int tag,
+    MIMPI_Comm comm
+);
+
+/// @brief Receives data from the specified process of a communicator.
+///
+/// Works as @ref MIMPI_Recv(), but @ref source is a rank in @ref comm
+/// and only messages sent within @ref comm are matched.
+/// @ref source may be `MIMPI_ANY_SOURCE`, then first matching message from
+/// any process is received and `MIMPI_ERROR_REMOTE_FINISHED` is returned
+/// only when all other processes of @ref comm have escaped _MPI block_.
+/// Deadlock is never reported for such receive.
+///
+MIMPI_Retcode MIMPI_Recv_comm(
+    void *data,
+    int count,
+    int source,
+    int tag,
+    MIMPI_Comm comm
+);
+
+/// @brief Receives message of at most given size, describing it in status.
+///
+/// Works as @ref MIMPI_Recv_comm(), but matches any message of at most
+/// @ref capacity bytes, so variable-length data needs no size message first.
+///
+/// @param data - place where received data is to be put.
+/// @param capacity - size of @ref data in bytes.
+/// @param source - rank of sender in @ref comm or `MIMPI_ANY_SOURCE`.
+/// @param tag - a discriminant of the message or `MIMPI_ANY_TAG`.
+/// @param comm - communicator of the message.
+/// @param status - place where actual size, source and tag of the message
+///        is to be put, or NULL.
+/// @return MIMPI return code as in @ref MIMPI_Recv_comm().
+///
+MIMPI_Retcode MIMPI_Recv_status(
+    void *data,
+    int capacity,
+    int source,
+    int tag,
+    MIMPI_Comm comm,
+    MIMPI_Status *status
+);
+
+/// @brief Sends data to one process and receives data from another one.
+///
+/// The receive is posted before sending starts, so both transfers go on at
+/// once and two processes exchanging data this way can't block each other.
+/// Receives as @ref MIMPI_Recv_status().
+///
+/// @param send_data - data to be sent.
+/// @param send_count - number of bytes to be sent.
+/// @param destination - rank of receiver in @ref comm.
+/// @param send_tag - a discriminant of the sent message.
+/// @param recv_data - place where received data is to be put.
+/// @param recv_capacity - size of @ref recv_data in bytes.
+/// @param source - rank of sender in @ref comm or `MIMPI_ANY_SOURCE`.
+/// @param recv_tag - a discriminant of the received message or `MIMPI_ANY_TAG`.
+/// @param comm - communicator of both messages.
+/// @param status - place where information about received message is to
+///        be put, or NULL.
+/// @return MIMPI return code as in @ref MIMPI_Send_comm() and
+///         @ref MIMPI_Recv_comm().
+///
+MIMPI_Retcode MIMPI_Sendrecv(
+    void const *send_data,
+    int send_count,
+    int destination,
+    int send_tag,
+    void *recv_data,
+    int recv_capacity,
+    int source,
+    int recv_tag,
+    MIMPI_Comm comm,
+    MIMPI_Status *status
+);
+
+/// @brief Works as @ref MIMPI_Sendrecv(), but received data replaces sent
+/// @ref data. Incoming message is buffered until the send ends.
+///
+MIMPI_Retcode MIMPI_Sendrecv_replace(
+    void *data,
+    int count,
+    int destination,
+    int send_tag,
+    int source,
+    int recv_tag,
+    MIMPI_Comm comm,
+    MIMPI_Status *status
+);
+
+/// @brief Sends data of any size to the specified process of a communicator.
+///
+/// Works as @ref MIMPI_Send_comm(), but @ref count may exceed `int`.
+/// Data is sent in chunks of 16 MiB, each only after receiver has posted its
+/// receive, so receiver never buffers any of it. Must be matched by
+/// @ref MIMPI_Recv_large() of the same @ref count and @ref tag.
+///
+MIMPI_Retcode MIMPI_Send_large(
+    void const *data,
+    size_t count,
+    int destination,
+    int tag,
+    MIMPI_Comm comm
+);
+
+/// @brief Receives data sent by @ref MIMPI_Send_large().
+///
+/// Works as @ref MIMPI_Recv_comm(), but @ref count may exceed `int` and
+/// @ref source must not be `MIMPI_ANY_SOURCE`. Data is put straight in
+/// @ref data, chunk by chunk.
+///
+MIMPI_Retcode MIMPI_Recv_large(
+    void *data,
+    size_t count,
+    int source,
+    int tag,
+    MIMPI_Comm comm
+);
+
+/// @brief Sends data of given datatype to the specified process of a communicator.
+///
+/// Works as @ref MIMPI_Send_comm() of `count * MIMPI_Type_size(type)` bytes,
+/// but bytes are gathered straight from the layout described by @ref type,
+/// without packing them first.
+///
+/// @param data - beginning of first element.
+/// @param count - number of elements of @ref type.
+/// @param type - layout of single element.
+///
+MIMPI_Retcode MIMPI_Send_type(
+    void const *data,
+    int count,
+    MIMPI_Datatype type,
+    int destination,
+    int tag,
+    MIMPI_Comm comm
+);
+
+/// @brief Receives data of given datatype.
+///
+/// Works as @ref MIMPI_Recv_comm() of `count * MIMPI_Type_size(type)` bytes,
+/// which are scattered to the layout described by @ref type. Matches any
+/// message of that size, regardless of datatype used by sender.
+///
+MIMPI_Retcode MIMPI_Recv_type(
+    void *data,
+    int count,
+    MIMPI_Datatype type,
+    int source,
+    int tag,
+    MIMPI_Comm comm
+);
+
+/// @brief Waits for a message without receiving it.
+///
+/// Blocks until message sent within @ref comm from @ref source tagged with
+/// @ref tag can be received, then describes it in @ref status.
+/// The message is left to be received by a following receive call.
+///
+/// @param source - rank of sender in @ref comm or `MIMPI_ANY_SOURCE`.
+/// @param tag - a discriminant of the message or `MIMPI_ANY_TAG`.
+/// @param comm - communicator of the message.
+/// @param status - place where information about message is to be put.
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation ended successfully.
+///         - `MIMPI_ERROR_ATTEMPTED_SELF_OP` if process attempted to probe itself
+///         - `MIMPI_ERROR_NO_SUCH_RANK` if there is no process with rank
+///           @ref source in @ref comm.
+///         - `MIMPI_ERROR_REMOTE_FINISHED` if @ref source (for `MIMPI_ANY_SOURCE`
+///           every other process of @ref comm) has already escaped _MPI block_.
+///         - `MIMPI_ERROR_DEADLOCK_DETECTED` if a deadlock has been detected
+///           and therefore this call would else never return.
+///
+MIMPI_Retcode MIMPI_Probe(
+    int source,
+    int tag,
+    MIMPI_Comm comm,
+    MIMPI_Status *status
+);
+
+/// @brief Checks for a message without receiving it.
+///
+/// Works as @ref MIMPI_Probe(), but never blocks. Sets @ref flag whether
+/// a matching message is available; @ref status is filled only if it is.
+///
+MIMPI_Retcode MIMPI_Iprobe(
+    int source,
+    int tag,
+    MIMPI_Comm comm,
+    bool *flag,
+    MIMPI_Status *status
+);
+
+/// @brief Creates a persistent send request.
+///
+/// Validates @ref destination and prepares message header once, so that
+/// every following @ref MIMPI_Start() only sends current content of @ref data.
+///
+/// @param data - data to be sent, read on every start.
+/// @param count - number of bytes of data to be sent.
+/// @param destination - rank of the process who is to receive the data.
+/// @param tag - a discriminant of the data.
+/// @param comm - communicator in which @ref destination is ranked.
+/// @param request - place where handle of created request is to be put.
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if request was created.
+///         - `MIMPI_ERROR_ATTEMPTED_SELF_OP` if process attempted to send to itself
+///         - `MIMPI_ERROR_NO_SUCH_RANK` if there is no process with rank
+///           @ref destination in @ref comm.
+///
+MIMPI_Retcode MIMPI_Send_init(
+    void const *data,
+    int count,
+    int destination,
+    int tag,
+    MIMPI_Comm comm,
+    MIMPI_Request *request
+);
+
+/// @brief Creates a persistent receive request.
+///
+/// Every @ref MIMPI_Start() registers matching slot, so that arriving
+/// message is put directly in @ref data, without intermediate bufor.
+///
+/// @param data - place where received data is to be put.
+/// @param count - number of bytes of data to be received.
+/// @param source - rank of the process for data from we are waiting.
+/// @param tag - a discriminant of the data.
+/// @param comm - communicator in which @ref source is ranked.
+/// @param request - place where handle of created request is to be put.
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if request was created.
+///         - `MIMPI_ERROR_ATTEMPTED_SELF_OP` if process attempted to receive from itself
+///         - `MIMPI_ERROR_NO_SUCH_RANK` if there is no process with rank
+///           @ref source in @ref comm.
+///
+MIMPI_Retcode MIMPI_Recv_init(
+    void *data,
+    int count,
+    int source,
+    int tag,
+    MIMPI_Comm comm,
+    MIMPI_Request *request
+);
+
+/// @brief Starts a persistent request.
+///
+/// Send is performed at once. Receive is only posted,
+/// its completion has to be awaited with @ref MIMPI_Wait().
+/// Request must not be started again before it is awaited.
+///
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation started successfully.
+///         - `MIMPI_ERROR_REMOTE_FINISHED` if the peer process
+///           has already escaped _MPI block_.
+///
+MIMPI_Retcode MIMPI_Start(MIMPI_Request request);
+
+/// @brief Waits for completion of started request.
+///
+/// @return MIMPI return code of the operation, as in @ref MIMPI_Send()
+///         and @ref MIMPI_Recv().
+///
+MIMPI_Retcode MIMPI_Wait(MIMPI_Request request);
+
+/// @brief Checks whether started request has completed, without blocking.
+///
+/// @param flag - place where true is put if request has completed.
+/// @return MIMPI return code of the operation if it has completed
+///         (then request stops being active), `MIMPI_SUCCESS` otherwise.
+///
+MIMPI_Retcode MIMPI_Test(MIMPI_Request request, bool *flag);
+
+/// @brief Frees request and sets handle to NULL.
+///
+/// Request must not be active.
+///
+void MIMPI_Request_free(MIMPI_Request *request);
+
 /// @brief Synchronises all processes.
 ///
 /// Blocks execution of the calling process until all processes execute
 /// this function. In particular, every process executes all instructions
 /// preceding the call before any process executes any instruction
 /// following the call. 
+/// Unless deadlock detection is enabled, it is a sense reversing barrier
+/// on a counter in memory shared by all processes.
 ///
 /// @return MIMPI return code:
 ///         - `MIMPI_SUCCESS` if operation ended successfully.
@@ -124,9 +503,12 @@ MIMPI_Retcode MIMPI_Barrier();
 /// Makes @ref count bytes of data at address @ref data in process @ref root
 /// available among all processes at address @ref data.
 /// Additionally, is a synchronisation point similarly to @ref MIMPI_Barrier.
+/// Unless deadlock detection is enabled, broadcast in the world goes through
+/// memory shared by all processes: root writes data once and everyone reads it.
 ///
 /// @param data - for @ref root, data to be broadcast; for other processes,
-///               place where data are to be put.
+///               place where data are to be put. Data is sent and received
+///               in place, without copying to a temporary bufor.
 /// @param count - number of bytes of data to be broadcast.
 /// @param root - rank of the process whose data are to be broadcast.
 ///
@@ -151,8 +533,15 @@ MIMPI_Retcode MIMPI_Bcast(
 /// stored at address @ref send_data in every process. The reduction's result
 /// is put at @ref recv_data *ONLY* in the process with rank @ref root.
 /// Additionally, is a synchronisation point similarly to @ref MIMPI_Barrier.
+/// Unless deadlock detection is enabled, reduction in the world goes through
+/// memory shared by all processes, where each process reduces its own slice
+/// of everyone's data. Otherwise data travels up the tree in segments of
+/// `MIMPI_REDUCE_SEGMENT` bytes (environment variable, 64 KiB by default),
+/// so that reducing one segment overlaps with receiving the next one.
 ///
-/// @param send_data - data to be reduced.
+/// @param send_data - data to be reduced, or `MIMPI_IN_PLACE` if data to be
+///        reduced is in @ref recv_data; then no copy of data is made and
+///        @ref recv_data of processes other than @ref root may be overwritten.
 /// @param recv_data - place where reduction's result is to be put.
 /// @param count - number of bytes of data to be reduced.
 /// @param op - a particular operation to be performed for reduction.
@@ -175,4 +564,566 @@ MIMPI_Retcode MIMPI_Reduce(
     int root
 );
 
+/// @brief Computes inclusive prefix reduction over processes.
+///
+/// Puts at @ref recv_data of process with rank i the reduction of kind
+/// @ref op of @ref send_data of processes with ranks 0, ..., i, combined
+/// in rank order. Takes log(n) rounds of communication.
+///
+/// @param send_data - data to be reduced, or `MIMPI_IN_PLACE` if data to be
+///        reduced is in @ref recv_data.
+/// @param recv_data - place where result is to be put.
+/// @param count - number of bytes in every process.
+/// @param op - a particular operation to be performed for reduction.
+///
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation ended successfully.
+///         - `MIMPI_ERROR_REMOTE_FINISHED` if any process in the world
+///            needed for the result has already escaped _MPI block_.
+///         - `MIMPI_ERROR_DEADLOCK_DETECTED` if a deadlock has been detected
+///           and therefore this call would else never return.
+///
+MIMPI_Retcode MIMPI_Scan(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op
+);
+
+/// @brief Computes exclusive prefix reduction over processes.
+///
+/// Works as @ref MIMPI_Scan(), but process with rank i gets the reduction
+/// over ranks 0, ..., i - 1. @ref recv_data of process 0 is left untouched.
+///
+MIMPI_Retcode MIMPI_Exscan(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op
+);
+
+/// @brief Starts synchronisation of all processes of a communicator.
+///
+/// Nonblocking version of @ref MIMPI_Barrier_comm(). Collective is advanced
+/// by incoming messages in the background, and completed by @ref MIMPI_Wait()
+/// or @ref MIMPI_Test() on @ref request, which then must be freed with
+/// @ref MIMPI_Request_free(). All processes of @ref comm must start their
+/// nonblocking collectives in the same order. Deadlock is never reported
+/// for them. Messages larger than 320 bytes are sent only inside MIMPI calls.
+///
+/// @param comm - communicator of the collective.
+/// @param request - place where handle of the collective is put.
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation started successfully.
+///
+MIMPI_Retcode MIMPI_Ibarrier(MIMPI_Comm comm, MIMPI_Request *request);
+
+/// @brief Starts broadcast, as @ref MIMPI_Ibarrier() does for barrier.
+///
+/// @ref data must not be used until the collective completes.
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation started successfully.
+///         - `MIMPI_ERROR_NO_SUCH_RANK` if there is no process with rank
+///           @ref root in @ref comm.
+///
+MIMPI_Retcode MIMPI_Ibcast(
+    void *data,
+    int count,
+    int root,
+    MIMPI_Comm comm,
+    MIMPI_Request *request
+);
+
+/// @brief Starts reduction, as @ref MIMPI_Ibarrier() does for barrier.
+///
+/// @ref send_data is copied at start (unless it is `MIMPI_IN_PLACE`),
+/// @ref recv_data must not be used until the collective completes.
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation started successfully.
+///         - `MIMPI_ERROR_NO_SUCH_RANK` if there is no process with rank
+///           @ref root in @ref comm.
+///
+MIMPI_Retcode MIMPI_Ireduce(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op,
+    int root,
+    MIMPI_Comm comm,
+    MIMPI_Request *request
+);
+
+/// @brief Registers user defined reduction operation.
+///
+/// Created operation can be used everywhere a @ref MIMPI_Op is expected.
+/// All processes must create (and free) their operations in the same order,
+/// as operations are identified by the order of creation.
+/// Data given to the operation must consist of whole elements.
+///
+/// @param function - function combining elements.
+/// @param element_size - size of single element in bytes, positive.
+/// @param commutative - whether order of operands does not matter. Elements of
+///        non commutative operation are combined in rank order, while elements
+///        of commutative one are combined in order of arrival.
+/// @param op - place where created operation is put.
+///
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation ended successfully.
+///         - `MIMPI_ERROR_NO_SUCH_OP` if @ref function is NULL or
+///           @ref element_size is not positive; nothing is created then.
+///
+MIMPI_Retcode MIMPI_Op_create(
+    MIMPI_User_function function,
+    int element_size,
+    bool commutative,
+    MIMPI_Op *op
+);
+
+/// @brief Frees user defined operation and sets it to `MIMPI_OP_NULL`.
+/// Does nothing to built-in operations and `MIMPI_OP_NULL`.
+void MIMPI_Op_free(MIMPI_Op *op);
+
+/// @brief Creates datatype of @ref count blocks of @ref blocklength elements
+/// of @ref oldtype, beginnings of blocks being @ref stride elements apart.
+///
+/// E.g. column of row-major matrix of `n` columns of bytes is
+/// `MIMPI_Type_vector(rows, 1, n, MIMPI_BYTE, &column)`.
+/// Datatype has to be freed with @ref MIMPI_Type_free().
+///
+MIMPI_Retcode MIMPI_Type_vector(
+    int count,
+    int blocklength,
+    int stride,
+    MIMPI_Datatype oldtype,
+    MIMPI_Datatype *newtype
+);
+
+/// @brief Creates datatype of @ref count blocks, i-th being
+/// @ref blocklengths[i] elements of @ref oldtype starting
+/// @ref displacements[i] (nonnegative) elements from the beginning.
+///
+MIMPI_Retcode MIMPI_Type_indexed(
+    int count,
+    int const *blocklengths,
+    int const *displacements,
+    MIMPI_Datatype oldtype,
+    MIMPI_Datatype *newtype
+);
+
+/// @brief Creates datatype of @ref count blocks, i-th being
+/// @ref blocklengths[i] elements of @ref types[i] starting
+/// @ref displacements[i] (nonnegative) bytes from the beginning.
+///
+MIMPI_Retcode MIMPI_Type_create_struct(
+    int count,
+    int const *blocklengths,
+    int const *displacements,
+    MIMPI_Datatype const *types,
+    MIMPI_Datatype *newtype
+);
+
+/// @brief Frees datatype and sets it to `MIMPI_BYTE`.
+///
+/// Datatypes built from it stay valid.
+///
+void MIMPI_Type_free(MIMPI_Datatype *type);
+
+/// @brief Returns number of bytes of data in single element of datatype.
+int MIMPI_Type_size(MIMPI_Datatype type);
+
+/// @brief Synchronises all processes of a communicator.
+///
+/// Works as @ref MIMPI_Barrier(), but only processes of @ref comm take part.
+///
+MIMPI_Retcode MIMPI_Barrier_comm(MIMPI_Comm comm);
+
+/// @brief Broadcasts data to all processes of a communicator.
+///
+/// Works as @ref MIMPI_Bcast(), but only processes of @ref comm take part
+/// and @ref root is a rank in @ref comm.
+///
+MIMPI_Retcode MIMPI_Bcast_comm(
+    void *data,
+    int count,
+    int root,
+    MIMPI_Comm comm
+);
+
+/// @brief Broadcasts @ref count elements of datatype @ref type.
+///
+/// Works as @ref MIMPI_Bcast_comm(). Data is packed once at root and
+/// unpacked once at every other process.
+///
+MIMPI_Retcode MIMPI_Bcast_type(
+    void *data,
+    int count,
+    MIMPI_Datatype type,
+    int root,
+    MIMPI_Comm comm
+);
+
+/// @brief Reduces data from all processes of a communicator to one.
+///
+/// Works as @ref MIMPI_Reduce(), but only processes of @ref comm take part
+/// and @ref root is a rank in @ref comm.
+///
+MIMPI_Retcode MIMPI_Reduce_comm(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op,
+    int root,
+    MIMPI_Comm comm
+);
+
+/// @brief Computes inclusive prefix reduction over processes of a communicator.
+///
+/// Works as @ref MIMPI_Scan(), but only processes of @ref comm take part.
+///
+MIMPI_Retcode MIMPI_Scan_comm(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op,
+    MIMPI_Comm comm
+);
+
+/// @brief Computes exclusive prefix reduction over processes of a communicator.
+///
+/// Works as @ref MIMPI_Exscan(), but only processes of @ref comm take part.
+///
+MIMPI_Retcode MIMPI_Exscan_comm(
+    void const *send_data,
+    void *recv_data,
+    int count,
+    MIMPI_Op op,
+    MIMPI_Comm comm
+);
+
+/// @brief Returns the number of processes in communicator.
+int MIMPI_Comm_size(MIMPI_Comm comm);
+
+/// @brief Returns rank of this process in communicator.
+int MIMPI_Comm_rank(MIMPI_Comm comm);
+
+/// @brief Splits communicator into disjoint sub-communicators.
+///
+/// Collective over @ref comm. Processes passing the same @ref color end up
+/// in the same new communicator, ranked by @ref key (ties broken by rank
+/// in @ref comm). Process passing `MIMPI_UNDEFINED` as @ref color
+/// gets `MIMPI_COMM_NULL`.
+///
+/// @param comm - communicator to be split.
+/// @param color - nonnegative discriminant of new communicator or `MIMPI_UNDEFINED`.
+/// @param key - value deciding order of ranks in new communicator.
+/// @param newcomm - place where handle of new communicator is to be put.
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation ended successfully.
+///         - `MIMPI_ERROR_REMOTE_FINISHED` if any process in @ref comm
+///            has already escaped _MPI block_.
+///
+MIMPI_Retcode MIMPI_Comm_split(
+    MIMPI_Comm comm,
+    int color,
+    int key,
+    MIMPI_Comm *newcomm
+);
+
+/// @brief Duplicates communicator.
+///
+/// Collective over @ref comm. New communicator has the same processes
+/// and ranks, but separate message context.
+///
+MIMPI_Retcode MIMPI_Comm_dup(MIMPI_Comm comm, MIMPI_Comm *newcomm);
+
+/// @brief Frees communicator created by this library and sets handle
+/// to `MIMPI_COMM_NULL`.
+void MIMPI_Comm_free(MIMPI_Comm *comm);
+
+/// @brief Creates communicator with cartesian topology.
+///
+/// Collective over @ref comm. New communicator has the same processes and
+/// ranks, laid out in row-major order on a grid of @ref ndims dimensions.
+/// Process has two neighbours in each dimension d: lower one (number 2d)
+/// and higher one (number 2d + 1). Neighbours over the edge of a not periodic
+/// dimension don't exist, so their parts of buffers are not used.
+///
+/// @param comm - communicator whose processes form the grid.
+/// @param ndims - number of dimensions.
+/// @param dims - size of grid in each dimension.
+/// @param periods - whether each dimension wraps around.
+/// @param newcomm - place where created communicator is put.
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation ended successfully.
+///         - `MIMPI_ERROR_NO_SUCH_RANK` if grid size differs from size of @ref comm.
+///         - `MIMPI_ERROR_REMOTE_FINISHED` if any process of @ref comm
+///            has already escaped _MPI block_.
+///
+MIMPI_Retcode MIMPI_Cart_create(
+    MIMPI_Comm comm,
+    int ndims,
+    int const *dims,
+    bool const *periods,
+    MIMPI_Comm *newcomm
+);
+
+/// @brief Creates communicator with general graph topology.
+///
+/// Collective over @ref comm. Every process gives its own neighbours; the
+/// graph must be symmetric (if a lists b, b lists a the same number of times).
+/// Repeated neighbours are matched in order of listing.
+///
+/// @param comm - communicator whose processes form the graph.
+/// @param neighbors_cnt - number of neighbours of this process.
+/// @param neighbor_ranks - ranks in @ref comm of neighbours.
+/// @param newcomm - place where created communicator is put.
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation ended successfully.
+///         - `MIMPI_ERROR_NO_SUCH_RANK` if some neighbour is not in @ref comm.
+///         - `MIMPI_ERROR_REMOTE_FINISHED` if any process of @ref comm
+///            has already escaped _MPI block_.
+///
+MIMPI_Retcode MIMPI_Graph_create(
+    MIMPI_Comm comm,
+    int neighbors_cnt,
+    int const *neighbor_ranks,
+    MIMPI_Comm *newcomm
+);
+
+/// @brief Returns number of neighbours (including not existing ones of
+/// cartesian topology), that is number of blocks in neighbourhood buffers.
+int MIMPI_Neighbors_count(MIMPI_Comm comm);
+
+/// @brief Sends the same data to every neighbour and receives data from them.
+///
+/// All transfers are done at once. Block i of @ref recv_data
+/// (@ref count bytes at offset i * @ref count) comes from neighbour i.
+/// Process that is its own neighbour (e.g. in periodic dimension of
+/// size 1) gets its own data copied.
+///
+/// @param send_data - data to be sent.
+/// @param count - number of bytes sent to and received from each neighbour.
+/// @param recv_data - place for data of all neighbours.
+/// @param comm - communicator with topology.
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation ended successfully.
+///         - `MIMPI_ERROR_REMOTE_FINISHED` if some neighbour has already
+///            escaped _MPI block_.
+///         - `MIMPI_ERROR_DEADLOCK_DETECTED` if a deadlock has been detected
+///           and therefore this call would else never return.
+///
+MIMPI_Retcode MIMPI_Neighbor_allgather(
+    void const *send_data,
+    int count,
+    void *recv_data,
+    MIMPI_Comm comm
+);
+
+/// @brief Sends separate data to every neighbour and receives data from them.
+///
+/// Works as @ref MIMPI_Neighbor_allgather(), but block i of @ref send_data
+/// is sent to neighbour i.
+///
+MIMPI_Retcode MIMPI_Neighbor_alltoall(
+    void const *send_data,
+    int count,
+    void *recv_data,
+    MIMPI_Comm comm
+);
+
+/// @brief Handle of one-sided communication window.
+typedef struct win_t *MIMPI_Win;
+
+/// @brief Allocates window memory exposed to one-sided operations.
+///
+/// Collective over @ref comm. Every process allocates @ref size bytes,
+/// which are placed in memory shared with other processes of @ref comm,
+/// so that @ref MIMPI_Put() and @ref MIMPI_Get() are plain copies
+/// not involving the target process.
+///
+/// @param size - number of bytes of window memory of this process.
+/// @param comm - communicator whose processes may access the window.
+/// @param base - place where address of window memory is to be put.
+/// @param win - place where handle of the window is to be put.
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation ended successfully.
+///         - `MIMPI_ERROR_REMOTE_FINISHED` if any process in @ref comm
+///            has already escaped _MPI block_.
+///
+MIMPI_Retcode MIMPI_Win_allocate(
+    int size,
+    MIMPI_Comm comm,
+    void **base,
+    MIMPI_Win *win
+);
+
+/// @brief Frees window and sets handle to NULL.
+///
+/// Collective over window's communicator.
+///
+MIMPI_Retcode MIMPI_Win_free(MIMPI_Win *win);
+
+/// @brief Copies @ref count bytes of @ref origin_data to window memory
+/// of process @ref target, starting at byte @ref offset.
+///
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation ended successfully.
+///         - `MIMPI_ERROR_NO_SUCH_RANK` if there is no process with rank
+///           @ref target in window's communicator.
+///
+MIMPI_Retcode MIMPI_Put(
+    void const *origin_data,
+    int count,
+    int target,
+    int offset,
+    MIMPI_Win win
+);
+
+/// @brief Copies @ref count bytes of window memory of process @ref target,
+/// starting at byte @ref offset, to @ref origin_data.
+///
+/// Return codes are as in @ref MIMPI_Put().
+///
+MIMPI_Retcode MIMPI_Get(
+    void *origin_data,
+    int count,
+    int target,
+    int offset,
+    MIMPI_Win win
+);
+
+/// @brief Combines @ref count bytes of @ref origin_data into window memory
+/// of process @ref target, starting at byte @ref offset, with operation @ref op.
+///
+/// Accumulations to the same target are atomic with respect to each other.
+/// Return codes are as in @ref MIMPI_Put().
+///
+MIMPI_Retcode MIMPI_Accumulate(
+    void const *origin_data,
+    int count,
+    MIMPI_Op op,
+    int target,
+    int offset,
+    MIMPI_Win win
+);
+
+/// @brief Synchronises all processes of window.
+///
+/// Every operation on the window issued before the fence is visible
+/// to every process after it. Return codes are as in @ref MIMPI_Barrier().
+///
+MIMPI_Retcode MIMPI_Win_fence(MIMPI_Win win);
+
+/// @brief Acquires exclusive lock on window memory of process @ref target.
+///
+/// Return codes are as in @ref MIMPI_Put().
+///
+MIMPI_Retcode MIMPI_Win_lock(int target, MIMPI_Win win);
+
+/// @brief Releases lock acquired with @ref MIMPI_Win_lock().
+MIMPI_Retcode MIMPI_Win_unlock(int target, MIMPI_Win win);
+
+/// @brief Handle of a file opened by all processes of a communicator.
+typedef struct file_t *MIMPI_File;
+
+/// @brief Opens file for collective and independent I/O.
+///
+/// Collective over @ref comm. @ref flags are as in `open` (e.g.
+/// `O_CREAT | O_WRONLY`); file is created or truncated only once, by process
+/// of rank 0, before others open it.
+///
+/// `MIMPI_FILE_AGGREGATORS` environment variable sets number of processes
+/// doing actual I/O in @ref MIMPI_File_write_at_all() and
+/// @ref MIMPI_File_read_at_all() (default one in four processes,
+/// 0 means that every process does its own I/O).
+///
+/// @param comm - communicator whose processes access the file.
+/// @param path - path of the file.
+/// @param flags - flags of `open`.
+/// @param file - place where handle of the file is to be put.
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation ended successfully.
+///         - `MIMPI_ERROR_REMOTE_FINISHED` if any process in @ref comm
+///            has already escaped _MPI block_.
+///
+MIMPI_Retcode MIMPI_File_open(
+    MIMPI_Comm comm,
+    char const *path,
+    int flags,
+    MIMPI_File *file
+);
+
+/// @brief Closes file and sets handle to NULL.
+///
+/// Collective over file's communicator; all writes of every process
+/// are done when it returns.
+///
+MIMPI_Retcode MIMPI_File_close(MIMPI_File *file);
+
+/// @brief Writes @ref count elements of @ref filetype to file.
+///
+/// Consecutive bytes of @ref data go to bytes of consecutive elements
+/// of @ref filetype laid out in file from byte @ref offset (with
+/// `MIMPI_BYTE` simply to @ref count bytes starting at @ref offset).
+/// Only this process takes part.
+///
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation ended successfully.
+///
+MIMPI_Retcode MIMPI_File_write_at(
+    MIMPI_File file,
+    size_t offset,
+    void const *data,
+    int count,
+    MIMPI_Datatype filetype
+);
+
+/// @brief Reads @ref count elements of @ref filetype from file.
+///
+/// Works as @ref MIMPI_File_write_at() in opposite direction. Bytes past
+/// end of file are read as zeros.
+///
+MIMPI_Retcode MIMPI_File_read_at(
+    MIMPI_File file,
+    size_t offset,
+    void *data,
+    int count,
+    MIMPI_Datatype filetype
+);
+
+/// @brief Collective version of @ref MIMPI_File_write_at().
+///
+/// Called by every process of file's communicator, each with its own
+/// part of file. File range written by all processes is split into
+/// aligned regions, one per aggregator process; others send their pieces
+/// to aggregators, which write every region with few large writes.
+/// When parts of processes are big and don't overlap, every process
+/// writes its own part instead.
+///
+/// @return MIMPI return code:
+///         - `MIMPI_SUCCESS` if operation ended successfully.
+///         - `MIMPI_ERROR_REMOTE_FINISHED` if any process of file's
+///            communicator has already escaped _MPI block_.
+///
+MIMPI_Retcode MIMPI_File_write_at_all(
+    MIMPI_File file,
+    size_t offset,
+    void const *data,
+    int count,
+    MIMPI_Datatype filetype
+);
+
+/// @brief Collective version of @ref MIMPI_File_read_at().
+///
+/// Aggregators read regions of file with few large reads and send
+/// every process its pieces, as in @ref MIMPI_File_write_at_all().
+///
+MIMPI_Retcode MIMPI_File_read_at_all(
+    MIMPI_File file,
+    size_t offset,
+    void *data,
+    int count,
+    MIMPI_Datatype filetype
+);
+
 #endif /* MIMPI_H */
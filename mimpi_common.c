@@ -6,10 +6,12 @@
 #include "mimpi_common.h"
 
 #include <errno.h>
+#include <linux/futex.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -57,4 +59,32 @@ int string_to_no(char* arg) {
         arg++;
     }
     return arg_converted;
-}
\ No newline at end of file
+}
+
+void futex_wait(atomic_int *addr, int value) {
+    // EAGAIN - value already changed, EINTR - signal came; caller checks again anyway.
+    if (syscall(SYS_futex, addr, FUTEX_WAIT, value, NULL, NULL, 0) == -1 && errno != EAGAIN && errno != EINTR)
+        syserr("futex wait failed");
+}
+
+void futex_wake(atomic_int *addr, int count) {
+    ASSERT_SYS_OK(syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0));
+}
+
+char const *stats_call_name(int call) {
+    switch (call) {
+    case Stats_none:         return "-";
+    case Stats_recv:         return "recv";
+    case Stats_send:         return "send";
+    case Stats_barrier:      return "barrier";
+    case Stats_bcast:        return "bcast";
+    case Stats_reduce:       return "reduce";
+    case Stats_allgather:    return "allgather";
+    case Stats_scan:         return "scan";
+    case Stats_large_credit: return "large credit";
+    case Stats_collective:   return "collective";
+    case Stats_shm_wait:     return "shm wait";
+    case Stats_shm_barrier:  return "shm barrier";
+    }
+    return "?";
+}
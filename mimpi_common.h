@@ -7,7 +7,9 @@
 #define MIMPI_COMMON_H
 
 #include <assert.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdnoreturn.h>
 
 /*
@@ -53,6 +55,94 @@ _Noreturn extern void fatal(const char* fmt, ...);
 #define IN (N*N+OUT)
 #define ENVVAR_LEN 50
 
+// Descriptor of memory shared by all processes, created by mimpirun.
+#define SHM_DESC (IN + N*N)
+#define SHM_CHUNK (64 * 1024)
+
+// Control channels of processes (every process writes to all of them).
+#define CTRL_OUT (SHM_DESC + 1)
+#define CTRL_IN (CTRL_OUT + N)
+
+// Number of steps of shared memory collectives done by a process, shifted
+// left by one. Lowest bit is set when the process has ended.
+struct shm_counter_t {
+    _Alignas(64) atomic_int value;
+    atomic_int sleepers;
+};
+
+struct shm_t {
+    struct shm_counter_t progress[N];
+
+    // Processes that came to current barrier, and its sense in lowest bit.
+    // Ending processes add 2 to barrier_sense to wake everyone waiting.
+    _Alignas(64) atomic_int barrier_count;
+    _Alignas(64) atomic_int barrier_sense;
+    atomic_int barrier_sleepers;
+
+    uint8_t bcast[2][SHM_CHUNK];
+    uint8_t contrib[N][SHM_CHUNK];
+    uint8_t result[SHM_CHUNK];
+};
+
+// Live counters of processes, kept in memory named STATS_NAME (with pid of
+// mimpirun) for as long as mimpirun runs, so that mimpitop can read them.
+// Every process writes only its own counters, with relaxed atomics.
+#define STATS_DESC (CTRL_IN + N)
+#define STATS_NAME "/mimpi_stats_%d"
+
+// What process is blocked on.
+enum stats_call_t {
+    Stats_none,
+    Stats_recv,
+    Stats_send,
+    Stats_barrier,
+    Stats_bcast,
+    Stats_reduce,
+    Stats_allgather,
+    Stats_scan,
+    Stats_large_credit,
+    Stats_collective,
+    Stats_shm_wait,
+    Stats_shm_barrier,
+};
+
+struct stats_peer_t {
+    atomic_llong sent_messeges;
+    atomic_llong sent_bytes;
+    atomic_llong received_messeges;
+    atomic_llong received_bytes;
+};
+
+// pid              - pid of process (0 until it starts)
+// ended            - whether process has finalized
+// call, peer       - what process is blocked on and on whom (world rank, -1 if none or any)
+// blocked_ns       - time spent waiting for wanted messege
+// unexpected_*     - messeges that came before anybody waited for them
+struct stats_rank_t {
+    _Alignas(64) atomic_int pid;
+    atomic_int ended;
+    atomic_int call;
+    atomic_int peer;
+    atomic_llong blocked_ns;
+    atomic_llong unexpected_cnt;
+    atomic_llong unexpected_bytes;
+    struct stats_peer_t peers[N];
+};
+
+struct stats_t {
+    int size;
+    struct stats_rank_t ranks[N];
+};
+
+// Name of what process is blocked on.
+char const *stats_call_name(int call);
+
 int string_to_no(char* arg);
 
+// Sleeps while *addr equals value. Works also for memory shared between processes.
+void futex_wait(atomic_int *addr, int value);
+
+// Wakes up to count threads sleeping on addr.
+void futex_wake(atomic_int *addr, int count);
+
 #endif // MIMPI_COMMON_H
\ No newline at end of file
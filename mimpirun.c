@@ -4,8 +4,10 @@
 #include "mimpi_common.h"
 #include "channel.h"
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -45,6 +47,59 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    for (int i = 0; i < n; i++) {
+        int pipefd[2];
+        ASSERT_SYS_OK(channel(pipefd));
+
+        if (pipefd[0] != TEMP_DESC_1) {
+            ASSERT_SYS_OK(dup2(pipefd[0], TEMP_DESC_1));
+            ASSERT_SYS_OK(close(pipefd[0]));
+        }
+
+        if (pipefd[1] != TEMP_DESC_2) {
+            ASSERT_SYS_OK(dup2(pipefd[1], TEMP_DESC_2));
+            ASSERT_SYS_OK(close(pipefd[1]));
+        }
+
+        ASSERT_SYS_OK(dup2(TEMP_DESC_1, CTRL_IN + i));
+        ASSERT_SYS_OK(close(TEMP_DESC_1));
+
+        ASSERT_SYS_OK(dup2(TEMP_DESC_2, CTRL_OUT + i));
+        ASSERT_SYS_OK(close(TEMP_DESC_2));
+    }
+
+    // Shared memory is inherited through descriptor, so name is not needed.
+    char shm_name[ENVVAR_LEN];
+    sprintf(shm_name, "/mimpi_%d", getpid());
+
+    int shm_fd;
+    ASSERT_SYS_OK(shm_fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0600));
+    ASSERT_SYS_OK(shm_unlink(shm_name));
+    ASSERT_SYS_OK(ftruncate(shm_fd, sizeof(struct shm_t)));
+
+    if (shm_fd != SHM_DESC) {
+        ASSERT_SYS_OK(dup2(shm_fd, SHM_DESC));
+        ASSERT_SYS_OK(close(shm_fd));
+    }
+
+    // Counters are read by mimpitop through name, so it is kept until the end.
+    char stats_name[ENVVAR_LEN];
+    sprintf(stats_name, STATS_NAME, getpid());
+
+    int stats_fd;
+    ASSERT_SYS_OK(stats_fd = shm_open(stats_name, O_CREAT | O_EXCL | O_RDWR, 0600));
+    ASSERT_SYS_OK(ftruncate(stats_fd, sizeof(struct stats_t)));
+
+    struct stats_t *stats = mmap(NULL, sizeof(struct stats_t), PROT_READ | PROT_WRITE, MAP_SHARED, stats_fd, 0);
+    ASSERT_ZERO(stats == MAP_FAILED);
+    stats->size = n;
+    ASSERT_SYS_OK(munmap(stats, sizeof(struct stats_t)));
+
+    if (stats_fd != STATS_DESC) {
+        ASSERT_SYS_OK(dup2(stats_fd, STATS_DESC));
+        ASSERT_SYS_OK(close(stats_fd));
+    }
+
     char envvar_name[ENVVAR_LEN];
     char envvar_value[ENVVAR_LEN];
 
@@ -67,6 +122,9 @@ int main(int argc, char* argv[]) {
                         ASSERT_SYS_OK(close(IN + i1 * n + i2));
                     }
                 }
+
+                if (i1 != i)
+                    ASSERT_SYS_OK(close(CTRL_IN + i1));
             }
 
             sprintf(envvar_name, "MIMPI_%d", getpid());
@@ -85,6 +143,16 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    for (int i = 0; i < n; i++) {
+        ASSERT_SYS_OK(close(CTRL_IN + i));
+        ASSERT_SYS_OK(close(CTRL_OUT + i));
+    }
+
+    ASSERT_SYS_OK(close(SHM_DESC));
+    ASSERT_SYS_OK(close(STATS_DESC));
+
     for (int i = 0; i < n; i++)
         wait(NULL);
+
+    ASSERT_SYS_OK(shm_unlink(stats_name));
 }
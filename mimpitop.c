@@ -0,0 +1,128 @@
+/**
+ * This file is for implementation of mimpitop program, which shows counters
+ * of processes of running mimpirun job. Usage:
+ *     mimpitop <pid of mimpirun> [interval in ms, 0 to print once]
+ * Counters are only read, so job is not stopped or slowed down by it.
+ * */
+#include "mimpi_common.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_INTERVAL_MS 1000
+#define MEBI (1024.0 * 1024.0)
+
+static long long load(atomic_llong *counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+static long long sent_bytes(struct stats_rank_t *rank, int size) {
+    long long sum = 0;
+    for (int i = 0; i < size; i++)
+        sum += load(&rank->peers[i].sent_bytes);
+    return sum;
+}
+
+static void print_ranks(struct stats_t *stats, long long *last_sent, double interval) {
+    printf("rank     pid  state  blocked on   peer  blocked s   sent msgs   sent MiB"
+           "   recv msgs   recv MiB  unexp  unexp KiB  sent MiB/s\n");
+
+    for (int r = 0; r < stats->size; r++) {
+        struct stats_rank_t *rank = &stats->ranks[r];
+        long long sent_messeges = 0, received_messeges = 0, received = 0;
+
+        for (int i = 0; i < stats->size; i++) {
+            sent_messeges += load(&rank->peers[i].sent_messeges);
+            received_messeges += load(&rank->peers[i].received_messeges);
+            received += load(&rank->peers[i].received_bytes);
+        }
+
+        long long sent = sent_bytes(rank, stats->size);
+        int pid = atomic_load_explicit(&rank->pid, memory_order_relaxed);
+        int call = atomic_load_explicit(&rank->call, memory_order_relaxed);
+        int peer = atomic_load_explicit(&rank->peer, memory_order_relaxed);
+        char const *state = pid == 0 ? "init"
+                          : atomic_load_explicit(&rank->ended, memory_order_relaxed) ? "ended"
+                          : call == Stats_none ? "run" : "wait";
+
+        char peer_str[16] = "-";
+        if (call != Stats_none && peer >= 0)
+            sprintf(peer_str, "%d", peer);
+
+        printf("%4d %7d  %-5s  %-11s %5s %10.3f %11lld %10.2f %11lld %10.2f %6lld %10.1f",
+               r, pid, state, stats_call_name(call), peer_str, load(&rank->blocked_ns) * 1e-9,
+               sent_messeges, sent / MEBI, received_messeges, received / MEBI,
+               load(&rank->unexpected_cnt), load(&rank->unexpected_bytes) / 1024.0);
+
+        if (interval > 0)
+            printf(" %11.2f", (sent - last_sent[r]) / MEBI / interval);
+        printf("\n");
+
+        last_sent[r] = sent;
+    }
+}
+
+// Row is sender, column is receiver.
+static void print_matrix(struct stats_t *stats) {
+    printf("\nMiB sent  ");
+    for (int i = 0; i < stats->size; i++)
+        printf(" %8d", i);
+    printf("\n");
+
+    for (int r = 0; r < stats->size; r++) {
+        printf("%8d  ", r);
+        for (int i = 0; i < stats->size; i++)
+            printf(" %8.2f", load(&stats->ranks[r].peers[i].sent_bytes) / MEBI);
+        printf("\n");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2)
+        fatal("Usage: %s <pid of mimpirun> [interval in ms]\n", argv[0]);
+
+    int job = string_to_no(argv[1]);
+    int interval_ms = argc > 2 ? string_to_no(argv[2]) : DEFAULT_INTERVAL_MS;
+    if (job <= 0 || interval_ms < 0)
+        fatal("Arguments are in wrong format\n");
+
+    char stats_name[ENVVAR_LEN];
+    sprintf(stats_name, STATS_NAME, job);
+
+    int stats_fd = shm_open(stats_name, O_RDONLY, 0);
+    if (stats_fd == -1)
+        fatal("No counters of mimpirun with pid %d\n", job);
+
+    struct stats_t *stats = mmap(NULL, sizeof(struct stats_t), PROT_READ, MAP_SHARED, stats_fd, 0);
+    ASSERT_ZERO(stats == MAP_FAILED);
+    ASSERT_SYS_OK(close(stats_fd));
+
+    long long last_sent[N] = {0};
+    for (int r = 0; r < stats->size; r++)
+        last_sent[r] = sent_bytes(&stats->ranks[r], stats->size);
+
+    if (interval_ms == 0) {
+        print_ranks(stats, last_sent, 0);
+        print_matrix(stats);
+    }
+
+    while (interval_ms > 0 && kill(job, 0) == 0) {
+        struct timespec ts = {.tv_sec = interval_ms / 1000, .tv_nsec = (interval_ms % 1000) * 1000000L};
+        nanosleep(&ts, NULL);
+
+        // Clearing screen and moving cursor to top.
+        printf("\033[H\033[2J");
+        printf("mimpirun %d, %d processes\n\n", job, stats->size);
+        print_ranks(stats, last_sent, interval_ms / 1000.0);
+        print_matrix(stats);
+        fflush(stdout);
+    }
+
+    ASSERT_SYS_OK(munmap(stats, sizeof(struct stats_t)));
+    return 0;
+}